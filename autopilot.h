@@ -0,0 +1,304 @@
+#ifndef AUTOPILOT_H
+#define AUTOPILOT_H
+
+// Lookahead planner for the bird. It clones the world and steps the
+// clones with UpdateWorld(), so it sees the same physics and the same
+// future pipes as the game. The clones copy the random stream too.
+//
+// The planner keeps a frontier of clones Horizon ticks ahead of the
+// real world, each remembering the flaps that led there. Every step:
+//
+// - the frontier grows by one tick, every clone branching into a flap
+//   and a coast. Clones that hit something drop out.
+// - every clone votes for its first action, and the one with the most
+//   votes is taken. That keeps the most ways through the coming pipes
+//   open. Only clones lined up with their next gap vote while there are
+//   any, the others are often on their way over or under a pipe they
+//   cannot get back from.
+// - clones that started with the other action drop out
+//
+// Clones whose bird has the same height and velocity, rounded to
+// 1/AutopilotResolution, count as one state. Those are the only
+// differences that matter to the bird's future, so over the rounded
+// states the search is exhaustive up to MaxStates. Past that one state
+// stays per cell of an even grid over the heights and velocities there
+// are. Keeping the ones closest to some target instead loses the birds
+// that hug the edge of a gap, and those are the only ones that make it
+// when the next gap is far away.
+//
+// Only the new tick costs anything, about 2 * MaxStates world steps.
+// When the real world does something the planner did not expect, like a
+// pause or a human flap, it starts over from the real world.
+//
+// The horizon has to reach past the next pipe spawn, a pipe takes about
+// 75 ticks to reach the bird. Shorter horizons commit to heights the
+// next pipe rules out.
+//
+// The clones play without practice mode, so a hit ends them. Leaving
+// [BotFloorY, BotCeilingY] counts as a hit too.
+
+#include <math.h>
+
+#include "game.h"
+
+#define AUTOPILOT_MAX_HORIZON 128
+#define AUTOPILOT_PATH_WORDS (AUTOPILOT_MAX_HORIZON / 64)
+
+float AutopilotResolution = 20.0f;
+int AutopilotVelocityCells = 4;
+
+typedef struct {
+    world World;
+    uint64_t Path[AUTOPILOT_PATH_WORDS]; // flap bits, next step first
+} plannerState;
+
+typedef struct {
+    int Horizon;
+    int MaxStates;
+
+    // Frontier of up to MaxStates. The children of a tick go into the
+    // other array, so both hold 2 * MaxStates.
+    plannerState *States;
+    plannerState *Children;
+    int Count;
+    int Depth; // ticks the frontier is ahead of the real world
+
+    uint64_t *Keys; // hash set of 4 * MaxStates
+    int *Cells;     // pruning grid of MaxStates
+
+    world Expected; // the real world after the last decision
+    int Flap;
+
+    uint64_t Nodes; // world steps simulated, all decisions
+    uint64_t Decisions;
+    uint64_t Restarts;
+} autopilot;
+
+int InitAutopilot(autopilot *Pilot, int Horizon, int MaxStates) {
+    memset(Pilot, 0, sizeof(*Pilot));
+    Pilot->Horizon = Horizon < AUTOPILOT_MAX_HORIZON ? Horizon : AUTOPILOT_MAX_HORIZON;
+    Pilot->MaxStates = MaxStates > 2 ? MaxStates : 2;
+    Pilot->States = malloc(2 * Pilot->MaxStates * sizeof(plannerState));
+    Pilot->Children = malloc(2 * Pilot->MaxStates * sizeof(plannerState));
+    Pilot->Keys = malloc(4 * Pilot->MaxStates * sizeof(uint64_t));
+    Pilot->Cells = malloc(Pilot->MaxStates * sizeof(int));
+    return Pilot->States && Pilot->Children && Pilot->Keys && Pilot->Cells;
+}
+
+void FreeAutopilot(autopilot *Pilot) {
+    free(Pilot->States);
+    free(Pilot->Children);
+    free(Pilot->Keys);
+    free(Pilot->Cells);
+    memset(Pilot, 0, sizeof(*Pilot));
+}
+
+int IsBotAlive(world *World) {
+    float Y = World->Bird.Position.Y;
+    return World->Running && Y >= BotFloorY && Y <= BotCeilingY;
+}
+
+// Middle of the gap of the nearest pipe pair the bird has not reached
+// yet. Bottom pipes sit at even slots with their top pipe right after
+// them.
+
+float GetNextGapY(world *World) {
+    pipeStore *Pipes = &World->Pipes;
+    float Ahead = World->Bird.Position.X + BirdWidth / 2.0f + PipeWidth / 2.0f;
+    float NearestX = 1e30f;
+    float GapY = PipeStartY + PipeHeight / 2.0f + PipeVerticalSpace / 2.0f;
+
+    for(int Slot = 0; Slot + 1 < Pipes->Ring.Length; Slot += 2) {
+        if(Pipes->X[Slot] > Ahead && Pipes->X[Slot] < NearestX) {
+            NearestX = Pipes->X[Slot];
+            GapY = (Pipes->Y[Slot] + Pipes->Y[Slot + 1]) / 2.0f;
+        }
+    }
+    return GapY;
+}
+
+// How far the bird is from the middle of the next gap
+float ScoreState(world *World) {
+    return fabsf(World->Bird.Position.Y - GetNextGapY(World));
+}
+
+int GetPathBit(uint64_t *Path, int Tick) {
+    return (int)((Path[Tick / 64] >> (Tick % 64)) & 1);
+}
+
+void SetPathBit(uint64_t *Path, int Tick, int Flap) {
+    Path[Tick / 64] &= ~(1ull << (Tick % 64));
+    Path[Tick / 64] |= (uint64_t)Flap << (Tick % 64);
+}
+
+// Drops the first action
+void ShiftPath(uint64_t *Path) {
+    for(int Word = 0; Word < AUTOPILOT_PATH_WORDS; ++Word) {
+        Path[Word] >>= 1;
+        if(Word + 1 < AUTOPILOT_PATH_WORDS) Path[Word] |= Path[Word + 1] << 63;
+    }
+}
+
+// Rounded height and velocity, never 0 so 0 can mark empty slots
+
+uint64_t GetStateKey(bird *Bird) {
+    uint32_t Y = (uint32_t)(int32_t)(Bird->Position.Y * AutopilotResolution);
+    uint32_t Velocity = (uint32_t)(int32_t)(Bird->Velocity.Y * AutopilotResolution);
+    return (((uint64_t)Y << 32) | Velocity) + 1;
+}
+
+// Returns 0 if the key was already in the set
+int AddStateKey(uint64_t *Keys, int Capacity, uint64_t Key) {
+    uint64_t Hash = Key * 0x9E3779B97F4A7C15ull;
+    for(int Probe = 0; Probe < Capacity; ++Probe) {
+        uint64_t *Slot = &Keys[(Hash + Probe) % Capacity];
+        if(*Slot == Key) return 0;
+        if(!*Slot) {
+            *Slot = Key;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Keeps at most Keep of Count states, one per cell of a grid laid over
+// the heights and velocities that are there. Cells are even in size, so
+// the few birds at the edges stay next to the many in the middle.
+
+int PruneStates(plannerState *States, int Count, int Keep, int *Cells) {
+    int Columns = AutopilotVelocityCells < Keep ? AutopilotVelocityCells : Keep;
+    int Rows = Keep / Columns;
+
+    bird *First = &States[0].World.Bird;
+    float MinY = First->Position.Y, MaxY = MinY;
+    float MinV = First->Velocity.Y, MaxV = MinV;
+    for(int Index = 1; Index < Count; ++Index) {
+        bird *Bird = &States[Index].World.Bird;
+        if(Bird->Position.Y < MinY) MinY = Bird->Position.Y;
+        if(Bird->Position.Y > MaxY) MaxY = Bird->Position.Y;
+        if(Bird->Velocity.Y < MinV) MinV = Bird->Velocity.Y;
+        if(Bird->Velocity.Y > MaxV) MaxV = Bird->Velocity.Y;
+    }
+    float RowScale = Rows / (MaxY - MinY + 1e-3f);
+    float ColumnScale = Columns / (MaxV - MinV + 1e-3f);
+
+    memset(Cells, 0, Rows * Columns * sizeof(int));
+    int Kept = 0;
+    for(int Index = 0; Index < Count; ++Index) {
+        bird *Bird = &States[Index].World.Bird;
+        int Row = (int)((Bird->Position.Y - MinY) * RowScale);
+        int Column = (int)((Bird->Velocity.Y - MinV) * ColumnScale);
+
+        int *Cell = &Cells[Row * Columns + Column];
+        if(*Cell) continue;
+        *Cell = 1;
+        States[Kept++] = States[Index];
+    }
+    return Kept;
+}
+
+// Grows the frontier by one tick. Returns 0 and leaves the frontier as
+// it was if no clone survives the tick.
+
+int ExpandFrontier(autopilot *Pilot) {
+
+    int KeyCapacity = 4 * Pilot->MaxStates;
+    memset(Pilot->Keys, 0, KeyCapacity * sizeof(uint64_t));
+
+    int ChildCount = 0;
+    for(int Index = 0; Index < Pilot->Count; ++Index) {
+        for(int Flap = 0; Flap < 2; ++Flap) {
+            plannerState *Child = &Pilot->Children[ChildCount];
+            *Child = Pilot->States[Index];
+            SetPathBit(Child->Path, Pilot->Depth, Flap);
+
+            input Input = {.Flap = Flap};
+            UpdateWorld(&Child->World, &Input);
+            ++Pilot->Nodes;
+
+            if(IsBotAlive(&Child->World) &&
+               AddStateKey(Pilot->Keys, KeyCapacity, GetStateKey(&Child->World.Bird))) {
+                ++ChildCount;
+            }
+        }
+    }
+
+    if(!ChildCount) return 0;
+
+    if(ChildCount > Pilot->MaxStates) {
+        ChildCount = PruneStates(Pilot->Children, ChildCount, Pilot->MaxStates, Pilot->Cells);
+    }
+
+    plannerState *Swap = Pilot->States;
+    Pilot->States = Pilot->Children;
+    Pilot->Children = Swap;
+    Pilot->Count = ChildCount;
+    ++Pilot->Depth;
+    return 1;
+}
+
+int IsExpectedWorld(autopilot *Pilot, world *World) {
+    bird *Bird = &World->Bird;
+    bird *Expected = &Pilot->Expected.Bird;
+    return Pilot->Count > 0 && Pilot->Depth > 0 && !World->Pause &&
+           World->Tick == Pilot->Expected.Tick &&
+           Bird->Position.X == Expected->Position.X &&
+           Bird->Position.Y == Expected->Position.Y &&
+           Bird->Velocity.Y == Expected->Velocity.Y;
+}
+
+// Whether the bird should flap this step
+int RunAutopilot(autopilot *Pilot, world *World) {
+
+    if(!IsExpectedWorld(Pilot, World)) {
+        plannerState *Root = &Pilot->States[0];
+        memset(Root, 0, sizeof(*Root));
+        Root->World = *World;
+        Root->World.PracticeMode = 0;
+        Root->World.Pause = 0;
+        Pilot->Count = 1;
+        Pilot->Depth = 0;
+        ++Pilot->Restarts;
+    }
+
+    while(Pilot->Depth < Pilot->Horizon && ExpandFrontier(Pilot));
+
+    // With no clone past this step flap, falling is the likelier death
+    int Votes[2] = {0};
+    int Lined[2] = {0};
+    float Window = (PipeVerticalSpace - BirdHeight) / 2.0f;
+    for(int Index = 0; Index < Pilot->Count && Pilot->Depth > 0; ++Index) {
+        plannerState *State = &Pilot->States[Index];
+        int First = GetPathBit(State->Path, 0);
+        ++Votes[First];
+        if(ScoreState(&State->World) < Window) ++Lined[First];
+    }
+    if(Lined[0] + Lined[1]) {
+        Votes[0] = Lined[0];
+        Votes[1] = Lined[1];
+    }
+    Pilot->Flap = Pilot->Depth == 0 || Votes[1] > Votes[0];
+
+    if(Pilot->Depth > 0) {
+        int Kept = 0;
+        for(int Index = 0; Index < Pilot->Count; ++Index) {
+            plannerState *State = &Pilot->States[Index];
+            if(GetPathBit(State->Path, 0) != Pilot->Flap) continue;
+            ShiftPath(State->Path);
+            if(Kept != Index) Pilot->States[Kept] = *State;
+            ++Kept;
+        }
+        Pilot->Count = Kept;
+        --Pilot->Depth;
+    }
+
+    Pilot->Expected = *World;
+    Pilot->Expected.Pause = 0;
+    input Input = {.Flap = Pilot->Flap};
+    UpdateWorld(&Pilot->Expected, &Input);
+
+    ++Pilot->Decisions;
+    return Pilot->Flap;
+}
+
+#endif
@@ -0,0 +1,192 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+// Many independent worlds stepped together. Same rules as UpdateWorld()
+// without the trail and without practice mode: a world that hits a pipe
+// is done and stays frozen until ResetBatchWorld() is called for it, or
+// with AutoReset set it starts over on its next step.
+//
+// Worlds are stored as structure of arrays. Pipes are ring buffers of
+// MAX_PIPES_AMOUNT entries per world, world N owns the entries
+// [N * BATCH_PIPE_STRIDE, (N + 1) * BATCH_PIPE_STRIDE). The stride is
+// padded to whole AVX2 registers and unused slots sit far to the right
+// so the kernels can always run over the full stride.
+//
+// Every world draws its pipes from its own random stream, split off the
+// seed given to CreateBatch().
+
+#include "game.h"
+#include "kernels.h"
+
+#define BATCH_PIPE_STRIDE 16
+
+float BatchEmptyPipeX = 1e30f;
+
+typedef struct {
+    int Count;
+
+    random *Random;
+
+    float *BirdY;
+    float *BirdVelocity;
+
+    float *PipeX;
+    float *PipeY;
+    int *PipeLength;
+    int *PipeIndex;
+    int *PipeTicks;
+
+    int *Tick;
+    int *Score;
+    int *Episodes;
+    unsigned char *Done;
+
+    int AutoReset;
+
+    void *Memory;
+} worldBatch;
+
+void ResetBatchWorld(worldBatch *Batch, int World) {
+    Batch->BirdY[World] = BirdStartY;
+    Batch->BirdVelocity[World] = 0.0f;
+    Batch->PipeLength[World] = 0;
+    Batch->PipeIndex[World] = 0;
+    Batch->PipeTicks[World] = 0;
+    Batch->Tick[World] = 0;
+    Batch->Score[World] = 0;
+    Batch->Done[World] = 0;
+
+    for(int Index = 0; Index < BATCH_PIPE_STRIDE; ++Index) {
+        Batch->PipeX[World * BATCH_PIPE_STRIDE + Index] = BatchEmptyPipeX;
+        Batch->PipeY[World * BATCH_PIPE_STRIDE + Index] = 0.0f;
+    }
+}
+
+int CreateBatch(worldBatch *Batch, int Count, unsigned int Seed) {
+
+    size_t PipeCount = (size_t)Count * BATCH_PIPE_STRIDE;
+
+    size_t Size = 0;
+    Size += Count * sizeof(random);         // random streams
+    Size += 2 * Count * sizeof(float);      // bird
+    Size += 2 * PipeCount * sizeof(float);  // pipes
+    Size += 6 * Count * sizeof(int);        // counters
+    Size += Count * sizeof(unsigned char);  // done
+
+    char *Memory = malloc(Size);
+    if(!Memory) return 0;
+
+    memset(Batch, 0, sizeof(*Batch));
+    Batch->Count = Count;
+    Batch->Memory = Memory;
+
+    Batch->Random = (random *)Memory; Memory += Count * sizeof(random);
+    Batch->BirdY = (float *)Memory; Memory += Count * sizeof(float);
+    Batch->BirdVelocity = (float *)Memory; Memory += Count * sizeof(float);
+    Batch->PipeX = (float *)Memory; Memory += PipeCount * sizeof(float);
+    Batch->PipeY = (float *)Memory; Memory += PipeCount * sizeof(float);
+    Batch->PipeLength = (int *)Memory; Memory += Count * sizeof(int);
+    Batch->PipeIndex = (int *)Memory; Memory += Count * sizeof(int);
+    Batch->PipeTicks = (int *)Memory; Memory += Count * sizeof(int);
+    Batch->Tick = (int *)Memory; Memory += Count * sizeof(int);
+    Batch->Score = (int *)Memory; Memory += Count * sizeof(int);
+    Batch->Episodes = (int *)Memory; Memory += Count * sizeof(int);
+    Batch->Done = (unsigned char *)Memory;
+
+    random Root;
+    SeedRandom(&Root, Seed);
+
+    for(int World = 0; World < Count; ++World) {
+        ResetBatchWorld(Batch, World);
+        Batch->Episodes[World] = 0;
+        Batch->Random[World] = SplitRandom(&Root);
+    }
+
+    return 1;
+}
+
+void FreeBatch(worldBatch *Batch) {
+    free(Batch->Memory);
+    memset(Batch, 0, sizeof(*Batch));
+}
+
+void AddPipeToBatch(worldBatch *Batch, int World, float Y) {
+    int Slot = World * BATCH_PIPE_STRIDE + Batch->PipeIndex[World]++;
+    Batch->PipeX[Slot] = PipeStartX;
+    Batch->PipeY[Slot] = Y;
+    if(Batch->PipeLength[World] < MAX_PIPES_AMOUNT) {
+        ++Batch->PipeLength[World];
+    }
+    if(Batch->PipeIndex[World] >= MAX_PIPES_AMOUNT) {
+        Batch->PipeIndex[World] = 0;
+    }
+}
+
+// Steps worlds [First, Last). Actions holds one flap flag per world.
+
+void StepBatchRange(worldBatch *Batch, unsigned char *Actions, int First, int Last) {
+
+    float BirdStep = DeltaTime * BirdSpeed;
+    float PipeStep = DeltaTime * PipeSpeed;
+    float Up = 4 * Gravity * BirdStep;
+    float Down = -Gravity * BirdStep;
+
+    for(int World = First; World < Last; ++World) {
+
+        if(Batch->Done[World]) {
+            if(!Batch->AutoReset) continue;
+            ResetBatchWorld(Batch, World);
+        }
+
+        ++Batch->Tick[World];
+
+        // Bird
+
+        float Velocity = Batch->BirdVelocity[World] + (Actions[World] ? Up : Down);
+        if(Velocity >= BirdMaxVelocity) {
+            Velocity = BirdMaxVelocity;
+        }
+        float Y = Batch->BirdY[World] + Velocity * BirdStep;
+
+        Batch->BirdVelocity[World] = Velocity;
+        Batch->BirdY[World] = Y;
+
+        collisionBox Box = {
+            BirdStartX - BirdWidth / 2.0f,
+            BirdStartX + BirdWidth / 2.0f,
+            Y + BirdHeight / 2.0f,
+            Y - BirdHeight / 2.0f,
+            PipeWidth / 2.0f,
+            PipeHeight / 2.0f,
+        };
+
+        // Pipes, bottom pipes of a pair sit at even slots
+
+        float *PipeX = Batch->PipeX + World * BATCH_PIPE_STRIDE;
+        float *PipeY = Batch->PipeY + World * BATCH_PIPE_STRIDE;
+
+        if(Kernels.PipesHit(PipeX, PipeY, BATCH_PIPE_STRIDE, &Box)) {
+            Batch->Done[World] = 1;
+        }
+
+        uint32_t Crossed = Kernels.MovePipes(PipeX, BATCH_PIPE_STRIDE, PipeStep, BirdStartX);
+        Batch->Score[World] += CountBits(Crossed & 0x55555555);
+
+        Batch->Episodes[World] += Batch->Done[World];
+
+        // Spawn new pipe pair
+
+        if(++Batch->PipeTicks[World] >= PipeSpawnTicks) {
+            float Offset = (float)RandomBelow(&Batch->Random[World], 10) - 5;
+            AddPipeToBatch(Batch, World, PipeStartY + Offset);
+            AddPipeToBatch(Batch, World, PipeStartY + Offset + PipeHeight + PipeVerticalSpace);
+            Batch->PipeTicks[World] = 0;
+        }
+    }
+}
+
+void StepBatch(worldBatch *Batch, unsigned char *Actions) {
+    StepBatchRange(Batch, Actions, 0, Batch->Count);
+}
+
+#endif
@@ -0,0 +1,622 @@
+#define _POSIX_C_SOURCE 199309L
+#include <stdio.h>
+#include <stdlib.h>
+
+// Benchmarks for the simulation and rendering hot paths. Every
+// benchmark runs a number of samples of a fixed number of operations
+// and reports ns per operation as mean, min and percentiles over the
+// samples, plus heap allocations per operation.
+//
+// usage: bench [-samples N] [-filter TEXT] [-json OUT.json] [-seed N]
+//
+// With -json the results are also written as JSON, one object per
+// benchmark, to keep track of them over time.
+
+// Every allocation in the headers below goes through these, stdlib.h
+// is already included so only the calls get renamed
+
+long AllocationCount;
+long AllocationBytes;
+
+void *CountedMalloc(size_t Size) {
+    ++AllocationCount;
+    AllocationBytes += Size;
+    return malloc(Size);
+}
+
+void *CountedCalloc(size_t Count, size_t Size) {
+    ++AllocationCount;
+    AllocationBytes += Count * Size;
+    return calloc(Count, Size);
+}
+
+void *CountedRealloc(void *Memory, size_t Size) {
+    ++AllocationCount;
+    AllocationBytes += Size;
+    return realloc(Memory, Size);
+}
+
+#define malloc(Size) CountedMalloc(Size)
+#define calloc(Count, Size) CountedCalloc(Count, Size)
+#define realloc(Memory, Size) CountedRealloc(Memory, Size)
+
+#include "game.h"
+#include "render.h"
+#include "raster.h"
+#include "clock.h"
+#include "autopilot.h"
+#include "snapshot.h"
+#include "sweep.h"
+
+#define MAX_SAMPLES 10000
+
+// Runs Ops operations
+typedef void benchFunction(void *Data, long Ops);
+
+typedef struct {
+    char *Name;
+    benchFunction *Function;
+    void *Data;
+    long Ops;
+} benchmark;
+
+typedef struct {
+    char *Name;
+    long Ops;
+    int Samples;
+    double Mean;
+    double Min;
+    double P50;
+    double P90;
+    double P99;
+    double Allocations;
+    double Bytes;
+} benchResult;
+
+int SampleCount = 200;
+unsigned int Seed = 1;
+
+uint32_t BenchSink;
+
+int CompareDoubles(const void *A, const void *B) {
+    double X = *(const double *)A;
+    double Y = *(const double *)B;
+    return (X > Y) - (X < Y);
+}
+
+// Nearest rank on sorted samples
+double GetPercentile(double *Sorted, int Count, double Percent) {
+    int Index = (int)(Percent / 100.0 * Count + 0.5) - 1;
+    if(Index < 0) Index = 0;
+    if(Index >= Count) Index = Count - 1;
+    return Sorted[Index];
+}
+
+benchResult RunBenchmark(benchmark *Benchmark) {
+
+    static double Samples[MAX_SAMPLES];
+
+    int Count = SampleCount < MAX_SAMPLES ? SampleCount : MAX_SAMPLES;
+
+    // Warm up caches and branch predictors
+    Benchmark->Function(Benchmark->Data, Benchmark->Ops);
+
+    long Allocations = AllocationCount;
+    long Bytes = AllocationBytes;
+
+    double Total = 0.0;
+    for(int Sample = 0; Sample < Count; ++Sample) {
+        uint64_t Start = GetMonotonicNanoseconds();
+        Benchmark->Function(Benchmark->Data, Benchmark->Ops);
+        Samples[Sample] = (double)(GetMonotonicNanoseconds() - Start) / Benchmark->Ops;
+        Total += Samples[Sample];
+    }
+
+    double TotalOps = (double)Count * Benchmark->Ops;
+
+    benchResult Result = {
+        .Name = Benchmark->Name,
+        .Ops = Benchmark->Ops,
+        .Samples = Count,
+        .Mean = Total / Count,
+        .Allocations = (AllocationCount - Allocations) / TotalOps,
+        .Bytes = (AllocationBytes - Bytes) / TotalOps,
+    };
+
+    qsort(Samples, Count, sizeof(double), CompareDoubles);
+    Result.Min = Samples[0];
+    Result.P50 = GetPercentile(Samples, Count, 50.0);
+    Result.P90 = GetPercentile(Samples, Count, 90.0);
+    Result.P99 = GetPercentile(Samples, Count, 99.0);
+
+    return Result;
+}
+
+// Simulation
+
+float HoverY = 27.5f;
+
+void BenchWorldStep(void *Data, long Ops) {
+    world *World = Data;
+    input Input = {0};
+    for(long Op = 0; Op < Ops; ++Op) {
+        Input.Flap = (World->Bird.Position.Y < HoverY);
+        UpdateWorld(World, &Input);
+    }
+}
+
+// One coarse step of 6 steps, 1/10 s, the same hover bot
+void BenchWorldCoarse(void *Data, long Ops) {
+    world *World = Data;
+    input Input = {0};
+    for(long Op = 0; Op < Ops; ++Op) {
+        Input.Flap = (World->Bird.Position.Y < HoverY);
+        StepWorldCoarse(World, &Input, 6);
+    }
+}
+
+// One autopilot decision and the step it is for, mostly the one new tick
+// of cloned world steps on the planner's frontier
+
+typedef struct {
+    autopilot Pilot;
+    world World;
+} autopilotRun;
+
+void BenchAutopilot(void *Data, long Ops) {
+    autopilotRun *Run = Data;
+    input Input = {0};
+    for(long Op = 0; Op < Ops; ++Op) {
+        if(!IsBotAlive(&Run->World)) {
+            InitWorld(&Run->World, Seed);
+            Run->World.PracticeMode = 0;
+        }
+        Input.Flap = RunAutopilot(&Run->Pilot, &Run->World);
+        UpdateWorld(&Run->World, &Input);
+    }
+}
+
+// Snapshots of a world in the middle of a game. A clone is a save and a
+// restore, what rollback costs per step.
+
+typedef struct {
+    world World;
+    snapshot Snapshot;
+    uint8_t Data[MAX_SNAPSHOT_SIZE];
+    size_t Size;
+} snapshotRun;
+
+void BenchSnapshotClone(void *Data, long Ops) {
+    snapshotRun *Run = Data;
+    for(long Op = 0; Op < Ops; ++Op) {
+        SaveSnapshot(&Run->Snapshot, &Run->World);
+        Run->Snapshot.Tick += (int)Op & 1;
+        RestoreSnapshot(&Run->World, &Run->Snapshot);
+    }
+    BenchSink += (uint32_t)Run->World.Tick;
+}
+
+void BenchSnapshotSerialize(void *Data, long Ops) {
+    snapshotRun *Run = Data;
+    for(long Op = 0; Op < Ops; ++Op) {
+        Run->Size = SerializeWorld(&Run->World, Run->Data, sizeof(Run->Data));
+        BenchSink += Run->Data[Op % Run->Size];
+    }
+}
+
+void BenchSnapshotDeserialize(void *Data, long Ops) {
+    snapshotRun *Run = Data;
+    for(long Op = 0; Op < Ops; ++Op) {
+        BenchSink += (uint32_t)DeserializeWorld(&Run->Snapshot, Run->Data, Run->Size);
+    }
+}
+
+// Pipes for the collision benchmarks, spread like a running game
+
+typedef struct {
+    int Count;
+    float X[256];
+    float Y[256];
+} pipeSet;
+
+void FillPipeSet(pipeSet *Pipes, int Count) {
+    random Random;
+    SeedRandom(&Random, Seed);
+    Pipes->Count = Count;
+    for(int Index = 0; Index < Count; ++Index) {
+        Pipes->X[Index] = (float)RandomBelow(&Random, 50);
+        Pipes->Y[Index] = (float)RandomBelow(&Random, 60);
+    }
+}
+
+// One op is the bird against every pipe of the set
+
+void BenchRectangles(void *Data, long Ops) {
+    pipeSet *Pipes = Data;
+    rectangle Bird = {19.5f, 20.5f, 28.0f, 27.0f};
+    for(long Op = 0; Op < Ops; ++Op) {
+        for(int Index = 0; Index < Pipes->Count; ++Index) {
+            rectangle Pipe = {
+                Pipes->X[Index] - PipeWidth / 2.0f,
+                Pipes->X[Index] + PipeWidth / 2.0f,
+                Pipes->Y[Index] + PipeHeight / 2.0f,
+                Pipes->Y[Index] - PipeHeight / 2.0f,
+            };
+            BenchSink += RectanglesIntersect(&Bird, &Pipe);
+        }
+    }
+}
+
+void BenchPipesHit(void *Data, long Ops) {
+    pipeSet *Pipes = Data;
+    collisionBox Box = {19.5f, 20.5f, 28.0f, 27.0f, PipeWidth / 2.0f, PipeHeight / 2.0f};
+    for(long Op = 0; Op < Ops; ++Op) {
+        for(int Index = 0; Index < Pipes->Count; Index += 32) {
+            int Count = Pipes->Count - Index < 32 ? Pipes->Count - Index : 32;
+            BenchSink += Kernels.PipesHit(Pipes->X + Index, Pipes->Y + Index, Count, &Box);
+        }
+    }
+}
+
+void BenchAddPipe(void *Data, long Ops) {
+    pipeStore *Pipes = Data;
+    for(long Op = 0; Op < Ops; ++Op) {
+        AddPipe(Pipes, PipeStartX, (float)(Op & 15));
+    }
+}
+
+// Rendering
+
+typedef struct {
+    world World;
+    color *Background;
+    int XTiles;
+    int YTiles;
+    backgroundMesh BackgroundMesh;
+    commandList Commands;
+    bounds Visible;
+    rasterizer Rasterizer;
+} frameData;
+
+// What Init() does for the background: allocate and fill the tiles,
+// then bake them into one mesh
+
+void BenchBackgroundBuild(void *Data, long Ops) {
+    frameData *Frame = Data;
+    for(long Op = 0; Op < Ops; ++Op) {
+        random Random = Frame->World.Random;
+        JumpRandom(&Random);
+
+        color *Background = malloc(Frame->XTiles * Frame->YTiles * sizeof(color));
+        FillBackground(Background, Frame->XTiles, Frame->YTiles, &Random);
+
+        backgroundMesh Mesh = {0};
+        BakeBackground(&Mesh, Background, Frame->XTiles, Frame->YTiles, 0);
+        BenchSink += Mesh.VertexCount;
+
+        FreeBackgroundMesh(&Mesh);
+        free(Background);
+    }
+}
+
+// What Draw() does on the CPU before handing the commands to a
+// backend, which here is none
+
+void RecordFrame(frameData *Frame) {
+    commandList *Commands = &Frame->Commands;
+    ResetCommands(Commands);
+    BakeBackground(&Frame->BackgroundMesh, Frame->Background, Frame->XTiles, Frame->YTiles, 0);
+    PushBakedBackground(Commands, &Frame->BackgroundMesh, &Frame->Visible);
+    PushWorld(Commands, &Frame->World, 0.5f, &Frame->Visible);
+    BenchSink += Commands->InstanceCount;
+}
+
+void BenchDrawRecord(void *Data, long Ops) {
+    for(long Op = 0; Op < Ops; ++Op) {
+        RecordFrame(Data);
+    }
+}
+
+// Particles spraying off the bird, spawned evenly over one lifetime so
+// every age is there. One op records the whole pool, culled against the
+// same view as the frame.
+
+typedef struct {
+    particlePool Pool;
+    commandList *Commands;
+    bounds *Visible;
+    float Time;
+} particleRun;
+
+particleEffect BenchSparks = {
+    .Acceleration = {0.0f, -0.01f, 0.0f},
+    .Lifetime = 60.0f,
+    .StartColor = {1.0f, 0.8f, 0.2f, 1.0f},
+    .EndColor = {0.2f, 0.2f, 0.2f, 1.0f},
+    .FadeTime = 60.0f,
+    .Size = 0.25f,
+};
+
+int FillParticles(particleRun *Run, int Count, frameData *Frame) {
+    if(!CreateParticlePool(&Run->Pool, Count, &BenchSparks)) return 0;
+
+    random Random;
+    SeedRandom(&Random, Seed);
+    Run->Commands = &Frame->Commands;
+    Run->Visible = &Frame->Visible;
+    Run->Time = 1000.5f;
+
+    for(int Index = 0; Index < Count; ++Index) {
+        float Time = Run->Time - BenchSparks.Lifetime * (Index + 1) / Count;
+        v3 Velocity = {RandomZeroToOne(&Random) * 0.6f - 0.3f, RandomZeroToOne(&Random) * 0.6f - 0.2f, 0.0f};
+        EmitParticle(&Run->Pool, Time, Frame->World.Bird.Position, Velocity);
+    }
+    return 1;
+}
+
+void BenchParticles(void *Data, long Ops) {
+    particleRun *Run = Data;
+    for(long Op = 0; Op < Ops; ++Op) {
+        ResetCommands(Run->Commands);
+        PushParticles(Run->Commands, &Run->Pool, Run->Time, Run->Visible);
+        BenchSink += Run->Commands->InstanceCount;
+    }
+}
+
+void BenchDrawSoftware(void *Data, long Ops) {
+    frameData *Frame = Data;
+    for(long Op = 0; Op < Ops; ++Op) {
+        RecordFrame(Frame);
+        RasterizeCommands(&Frame->Rasterizer, &Frame->Commands, &Frame->BackgroundMesh);
+    }
+}
+
+// Vertex stage of the software backend alone, on a recorded frame
+void BenchDrawSetup(void *Data, long Ops) {
+    frameData *Frame = Data;
+    for(long Op = 0; Op < Ops; ++Op) {
+        SetupTriangles(&Frame->Rasterizer, &Frame->Commands, &Frame->BackgroundMesh);
+        BenchSink += Frame->Rasterizer.TriangleCount;
+    }
+}
+
+// Matrices and points for matrix.h, SIMD lanes against the scalar
+// versions. A keeps getting turned by Rotation, which leaves it the
+// same size, B is the game's view projection.
+typedef struct {
+    matrix A;
+    matrix B;
+    matrix Rotation;
+    vertex Vertices[1000];
+    float Clip[1000 * 4];
+} matrixRun;
+
+void FillMatrices(matrixRun *Run) {
+    random Random;
+    SeedRandom(&Random, Seed);
+    Run->A = IdentityMatrix();
+    Run->Rotation = (matrix){
+        0.6f, 0.8f, 0.0f, 0.0f,
+        -0.8f, 0.6f, 0.0f, 0.0f,
+        0.0f, 0.0f, 1.0f, 0.0f,
+        0.0f, 0.0f, 0.0f, 1.0f,
+    };
+    for(int Index = 0; Index < 1000; ++Index) {
+        Run->Vertices[Index].Position = (v3){RandomZeroToOne(&Random) * 60.0f, RandomZeroToOne(&Random) * 60.0f, 0.0f};
+    }
+}
+
+void BenchMatrixMultiplyScalar(void *Data, long Ops) {
+    matrixRun *Run = Data;
+    for(long Op = 0; Op < Ops; ++Op) {
+        Run->A = MultiplyMatrixScalar(&Run->A, &Run->Rotation);
+    }
+}
+
+void BenchMatrixMultiply(void *Data, long Ops) {
+    matrixRun *Run = Data;
+    for(long Op = 0; Op < Ops; ++Op) {
+        Run->A = MultiplyMatrix(&Run->A, &Run->Rotation);
+    }
+}
+
+void BenchMatrixInvert(void *Data, long Ops) {
+    matrixRun *Run = Data;
+    for(long Op = 0; Op < Ops; ++Op) {
+        matrix Inverse;
+        BenchSink += InvertMatrix(&Run->B, &Inverse);
+        BenchSink += Inverse.M[3][3] > 0.0f;
+    }
+}
+
+void BenchVisibleBounds(void *Data, long Ops) {
+    matrixRun *Run = Data;
+    for(long Op = 0; Op < Ops; ++Op) {
+        bounds Bounds = GetVisibleBounds(&Run->B, 0.0f);
+        BenchSink += Bounds.MaxX > Bounds.MinX;
+    }
+}
+
+void BenchPointsScalar(void *Data, long Ops) {
+    matrixRun *Run = Data;
+    for(long Op = 0; Op < Ops; ++Op) {
+        TransformPointsScalar(&Run->B, (v3){1.0f, 2.0f, 0.0f}, &Run->Vertices[0].Position,
+                              sizeof(vertex), 1000, Run->Clip);
+        BenchSink += Run->Clip[0] > 0.0f;
+    }
+}
+
+void BenchPoints(void *Data, long Ops) {
+    matrixRun *Run = Data;
+    for(long Op = 0; Op < Ops; ++Op) {
+        TransformPoints(&Run->B, (v3){1.0f, 2.0f, 0.0f}, &Run->Vertices[0].Position,
+                        sizeof(vertex), 1000, Run->Clip);
+        BenchSink += Run->Clip[0] > 0.0f;
+    }
+}
+
+void WriteResultsJSON(FILE *File, benchResult *Results, int Count) {
+    fprintf(File, "{\n  \"kernels\": \"%s\",\n  \"samples\": %d,\n  \"seed\": %u,\n  \"benchmarks\": [\n",
+            Kernels.Name, SampleCount, Seed);
+    for(int Index = 0; Index < Count; ++Index) {
+        benchResult *Result = &Results[Index];
+        fprintf(File,
+                "    {\"name\": \"%s\", \"ops\": %ld, \"samples\": %d, "
+                "\"ns_mean\": %.3f, \"ns_min\": %.3f, \"ns_p50\": %.3f, \"ns_p90\": %.3f, \"ns_p99\": %.3f, "
+                "\"allocs_per_op\": %.6f, \"bytes_per_op\": %.3f}%s\n",
+                Result->Name, Result->Ops, Result->Samples,
+                Result->Mean, Result->Min, Result->P50, Result->P90, Result->P99,
+                Result->Allocations, Result->Bytes, Index + 1 < Count ? "," : "");
+    }
+    fprintf(File, "  ]\n}\n");
+}
+
+int main(int ArgumentCount, char **Arguments) {
+
+    SelectKernels();
+
+    char *Filter = 0;
+    char *JSONPath = 0;
+
+    for(int Index = 1; Index + 1 < ArgumentCount; Index += 2) {
+        char *Name = Arguments[Index];
+        char *Value = Arguments[Index + 1];
+        if(!strcmp(Name, "-samples")) SampleCount = atoi(Value);
+        else if(!strcmp(Name, "-filter")) Filter = Value;
+        else if(!strcmp(Name, "-json")) JSONPath = Value;
+        else if(!strcmp(Name, "-seed")) Seed = (unsigned int)atol(Value);
+        else {
+            fprintf(stderr, "unknown option %s\n", Name);
+            return 1;
+        }
+    }
+    if(SampleCount < 1) SampleCount = 1;
+
+    // Data
+
+    InitMeshData();
+
+    static world World;
+    InitWorld(&World, Seed);
+
+    static world CoarseWorld;
+    InitWorld(&CoarseWorld, Seed);
+
+    static autopilotRun Autopilot;
+    InitWorld(&Autopilot.World, Seed);
+    Autopilot.World.PracticeMode = 0;
+
+    static pipeSet Pipes2, Pipes10, Pipes32, Pipes256;
+    FillPipeSet(&Pipes2, 2);
+    FillPipeSet(&Pipes10, 10);
+    FillPipeSet(&Pipes32, 32);
+    FillPipeSet(&Pipes256, 256);
+
+    static pipeStore PipeStore = {.Ring = {.Capacity = MAX_PIPES_AMOUNT}};
+
+    static frameData Frame;
+    InitWorld(&Frame.World, Seed);
+    input Input = {0};
+    for(int Step = 0; Step < 600; ++Step) {
+        Input.Flap = (Frame.World.Bird.Position.Y < HoverY);
+        UpdateWorld(&Frame.World, &Input);
+    }
+
+    static snapshotRun Snapshot;
+    Snapshot.World = Frame.World;
+    Snapshot.Size = SerializeWorld(&Snapshot.World, Snapshot.Data, sizeof(Snapshot.Data));
+    Frame.XTiles = 60;
+    Frame.YTiles = 60;
+    random TileRandom = Frame.World.Random;
+    JumpRandom(&TileRandom);
+    Frame.Background = malloc(Frame.XTiles * Frame.YTiles * sizeof(color));
+    FillBackground(Frame.Background, Frame.XTiles, Frame.YTiles, &TileRandom);
+
+    matrix View = GetViewMatrix((v3){25.0f, 30.0f, -35.0f});
+    matrix Projection = GetProjectionMatrix(384.0f / 561.0f, 1.0f, 1.0f, 100.0f);
+    Frame.Commands.ViewProjection = MultiplyMatrix(&View, &Projection);
+    Frame.Visible = GetVisibleBounds(&Frame.Commands.ViewProjection, 0.0f);
+
+    static particleRun Particles15, Particles1k, Particles100k;
+
+    static matrixRun Matrices;
+    FillMatrices(&Matrices);
+    Matrices.B = Frame.Commands.ViewProjection;
+
+    if(!InitAutopilot(&Autopilot.Pilot, 120, 512) ||
+       !Frame.Background || !CreateRasterizer(&Frame.Rasterizer, 384, 561, 0) ||
+       !FillParticles(&Particles15, 15, &Frame) ||
+       !FillParticles(&Particles1k, 1000, &Frame) ||
+       !FillParticles(&Particles100k, 100000, &Frame)) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    benchmark Benchmarks[] = {
+        {"world_step", BenchWorldStep, &World, 10000},
+        {"world_coarse_6", BenchWorldCoarse, &CoarseWorld, 10000},
+        {"autopilot_step", BenchAutopilot, &Autopilot, 100},
+        {"snapshot_clone", BenchSnapshotClone, &Snapshot, 10000},
+        {"snapshot_encode", BenchSnapshotSerialize, &Snapshot, 1000},
+        {"snapshot_decode", BenchSnapshotDeserialize, &Snapshot, 1000},
+        {"rectangles_2", BenchRectangles, &Pipes2, 10000},
+        {"rectangles_10", BenchRectangles, &Pipes10, 10000},
+        {"rectangles_32", BenchRectangles, &Pipes32, 10000},
+        {"rectangles_256", BenchRectangles, &Pipes256, 1000},
+        {"pipes_hit_10", BenchPipesHit, &Pipes10, 10000},
+        {"pipes_hit_256", BenchPipesHit, &Pipes256, 1000},
+        {"ring_add_pipe", BenchAddPipe, &PipeStore, 100000},
+        {"background_build", BenchBackgroundBuild, &Frame, 10},
+        {"draw_record", BenchDrawRecord, &Frame, 1000},
+        {"draw_software", BenchDrawSoftware, &Frame, 1},
+        {"draw_setup", BenchDrawSetup, &Frame, 100},
+        {"matrix_mul_scalar", BenchMatrixMultiplyScalar, &Matrices, 10000},
+        {"matrix_mul", BenchMatrixMultiply, &Matrices, 10000},
+        {"matrix_invert", BenchMatrixInvert, &Matrices, 10000},
+        {"visible_bounds", BenchVisibleBounds, &Matrices, 10000},
+        {"points_1k_scalar", BenchPointsScalar, &Matrices, 100},
+        {"points_1k", BenchPoints, &Matrices, 100},
+        {"particles_15", BenchParticles, &Particles15, 10000},
+        {"particles_1k", BenchParticles, &Particles1k, 100},
+        {"particles_100k", BenchParticles, &Particles100k, 1},
+    };
+    int BenchmarkCount = sizeof(Benchmarks) / sizeof(Benchmarks[0]);
+
+    benchResult Results[sizeof(Benchmarks) / sizeof(Benchmarks[0])];
+    int ResultCount = 0;
+
+    printf("kernels %s, matrix lanes %s, %d samples\n\n", Kernels.Name, MATRIX_LANES, SampleCount);
+    printf("%-18s %12s %12s %12s %12s %12s %10s %10s\n",
+           "benchmark", "mean ns/op", "min", "p50", "p90", "p99", "allocs/op", "bytes/op");
+
+    for(int Index = 0; Index < BenchmarkCount; ++Index) {
+        benchmark *Benchmark = &Benchmarks[Index];
+        if(Filter && !strstr(Benchmark->Name, Filter)) continue;
+
+        benchResult Result = RunBenchmark(Benchmark);
+        Results[ResultCount++] = Result;
+
+        printf("%-18s %12.2f %12.2f %12.2f %12.2f %12.2f %10.3f %10.1f\n",
+               Result.Name, Result.Mean, Result.Min, Result.P50, Result.P90, Result.P99,
+               Result.Allocations, Result.Bytes);
+    }
+
+    if(JSONPath) {
+        FILE *File = fopen(JSONPath, "w");
+        if(!File) {
+            fprintf(stderr, "could not write %s\n", JSONPath);
+            return 1;
+        }
+        WriteResultsJSON(File, Results, ResultCount);
+        fclose(File);
+    }
+
+    FreeAutopilot(&Autopilot.Pilot);
+    FreeParticlePool(&Particles15.Pool);
+    FreeParticlePool(&Particles1k.Pool);
+    FreeParticlePool(&Particles100k.Pool);
+    FreeRasterizer(&Frame.Rasterizer);
+    FreeBackgroundMesh(&Frame.BackgroundMesh);
+    free(Frame.Background);
+    return 0;
+}
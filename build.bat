@@ -1,5 +1,5 @@
 @echo off
 cl main.c ^
-/Fea.exe /Zi /nologo ^
+/Fea.exe /Zi /nologo /std:c11 /experimental:c11atomics ^
 /link ^
 user32.lib d3d11.lib d3dcompiler.lib dxguid.lib  
\ No newline at end of file
@@ -0,0 +1,4 @@
+#!/bin/sh
+cc headless.c -o headless -O2 -g -std=c11 -Wall -Wno-missing-braces -pthread "$@"
+cc bench.c -o bench -O2 -g -std=c11 -Wall -Wno-missing-braces -pthread "$@"
+cc env.c -o libenv.so -shared -fPIC -O2 -g -std=c11 -Wall -Wno-missing-braces -pthread "$@"
@@ -0,0 +1,234 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+// Video capture of software rendered frames. The rendering thread
+// copies each frame into one of a few buffers allocated up front and
+// goes on; a writer thread converts and writes them out in order:
+//
+//     renderer --copy--> [ring of QueueFrames buffers] --writer--> file
+//
+// The buffers go around in an spscRing from events.h, so handing one
+// over takes no lock. The writer sleeps on a condition variable while
+// the ring is empty. When the writer falls behind and every buffer is
+// taken, CaptureFrame() drops the frame instead of waiting, so capture
+// never holds up the caller. Dropped frames are counted; the video then
+// runs short by that many frames.
+//
+// Paths ending in .y4m get YUV4MPEG2, 4:4:4 BT.601 video range, which
+// most players and ffmpeg read as is. Anything else, a named pipe
+// included, gets the raw RGBA frames back to back, for example for
+//
+//     ffmpeg -f rawvideo -pixel_format rgba -video_size 384x561 -i OUT
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "raster.h"
+#include "events.h"
+
+#define MAX_CAPTURE_FRAMES 64 // power of two
+
+enum {CAPTURE_RAW, CAPTURE_Y4M};
+
+typedef struct {
+    FILE *File;
+    int Format;
+    int Width;
+    int Height;
+    int FramesPerSecond;
+
+    uint8_t *Frames[MAX_CAPTURE_FRAMES];
+    int Capacity; // power of two
+    spscRing Ring;
+    uint8_t *Planes; // writer only, Y4M frame
+
+    pthread_t Thread;
+    pthread_mutex_t Mutex;
+    pthread_cond_t Wake;
+    int Quit;
+
+    // Caller
+    long Captured;
+    long Dropped;
+    int MaxQueued;
+
+    // Writer
+    long Written;
+    uint64_t Bytes;
+    uint64_t WriteNanoseconds;
+    int Failed;
+} capture;
+
+// BT.601 video range, 8 bit fixed point
+
+void ConvertToY4M(uint8_t *Pixels, int Count, uint8_t *Planes) {
+    uint8_t *YPlane = Planes;
+    uint8_t *UPlane = Planes + Count;
+    uint8_t *VPlane = Planes + 2 * Count;
+
+    for(int Index = 0; Index < Count; ++Index) {
+        int R = Pixels[Index * 4];
+        int G = Pixels[Index * 4 + 1];
+        int B = Pixels[Index * 4 + 2];
+        YPlane[Index] = (uint8_t)(((66 * R + 129 * G + 25 * B + 128) >> 8) + 16);
+        UPlane[Index] = (uint8_t)(((-38 * R - 74 * G + 112 * B + 128) >> 8) + 128);
+        VPlane[Index] = (uint8_t)(((112 * R - 94 * G - 18 * B + 128) >> 8) + 128);
+    }
+}
+
+int WriteCapturedFrame(capture *Capture, uint8_t *Pixels) {
+    int Count = Capture->Width * Capture->Height;
+
+    if(Capture->Format == CAPTURE_Y4M) {
+        ConvertToY4M(Pixels, Count, Capture->Planes);
+        if(fputs("FRAME\n", Capture->File) < 0) return 0;
+        if(fwrite(Capture->Planes, 3, Count, Capture->File) != (size_t)Count) return 0;
+        Capture->Bytes += 6 + 3 * (uint64_t)Count;
+    } else {
+        if(fwrite(Pixels, 4, Count, Capture->File) != (size_t)Count) return 0;
+        Capture->Bytes += 4 * (uint64_t)Count;
+    }
+    return 1;
+}
+
+void *CaptureThread(void *Data) {
+    capture *Capture = Data;
+
+    for(;;) {
+        pthread_mutex_lock(&Capture->Mutex);
+        int Slot;
+        while((Slot = GetPopSlot(&Capture->Ring, Capture->Capacity)) < 0 && !Capture->Quit) {
+            pthread_cond_wait(&Capture->Wake, &Capture->Mutex);
+        }
+        pthread_mutex_unlock(&Capture->Mutex);
+
+        // Quit only once everything queued is written
+        if(Slot < 0) break;
+
+        uint64_t Start = GetMonotonicNanoseconds();
+        if(!Capture->Failed && !WriteCapturedFrame(Capture, Capture->Frames[Slot])) {
+            Capture->Failed = 1;
+        }
+        Capture->WriteNanoseconds += GetMonotonicNanoseconds() - Start;
+        ++Capture->Written;
+
+        FinishPop(&Capture->Ring);
+    }
+    return 0;
+}
+
+void FreeCaptureBuffers(capture *Capture) {
+    for(int Slot = 0; Slot < MAX_CAPTURE_FRAMES; ++Slot) {
+        free(Capture->Frames[Slot]);
+        Capture->Frames[Slot] = 0;
+    }
+    free(Capture->Planes);
+    Capture->Planes = 0;
+}
+
+// QueueFrames is rounded up to a power of two, at most
+// MAX_CAPTURE_FRAMES. Returns 0 if the file cannot be opened, the
+// buffers not allocated or the writer thread not started.
+
+int StartCapture(capture *Capture, char *Path, int Width, int Height, int FramesPerSecond, int QueueFrames) {
+
+    memset(Capture, 0, sizeof(*Capture));
+    Capture->Width = Width;
+    Capture->Height = Height;
+    Capture->FramesPerSecond = FramesPerSecond;
+
+    int Capacity = 1;
+    while(Capacity < QueueFrames && Capacity < MAX_CAPTURE_FRAMES) {
+        Capacity *= 2;
+    }
+    Capture->Capacity = Capacity;
+
+    size_t Length = strlen(Path);
+    Capture->Format = (Length > 4 && !strcmp(Path + Length - 4, ".y4m")) ? CAPTURE_Y4M : CAPTURE_RAW;
+
+    for(int Slot = 0; Slot < Capacity; ++Slot) {
+        Capture->Frames[Slot] = malloc((size_t)Width * Height * 4);
+        if(!Capture->Frames[Slot]) {
+            FreeCaptureBuffers(Capture);
+            return 0;
+        }
+    }
+    if(Capture->Format == CAPTURE_Y4M) {
+        Capture->Planes = malloc((size_t)Width * Height * 3);
+        if(!Capture->Planes) {
+            FreeCaptureBuffers(Capture);
+            return 0;
+        }
+    }
+
+    Capture->File = fopen(Path, "wb");
+    if(!Capture->File) {
+        FreeCaptureBuffers(Capture);
+        return 0;
+    }
+
+    if(Capture->Format == CAPTURE_Y4M &&
+       fprintf(Capture->File, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C444\n", Width, Height, FramesPerSecond) < 0) {
+        Capture->Failed = 1;
+    }
+
+    pthread_mutex_init(&Capture->Mutex, 0);
+    pthread_cond_init(&Capture->Wake, 0);
+    if(pthread_create(&Capture->Thread, 0, CaptureThread, Capture)) {
+        fclose(Capture->File);
+        Capture->File = 0;
+        pthread_mutex_destroy(&Capture->Mutex);
+        pthread_cond_destroy(&Capture->Wake);
+        FreeCaptureBuffers(Capture);
+        return 0;
+    }
+    return 1;
+}
+
+// Queues a copy of Target, which must have the capture's size. Returns
+// 0 if the frame was dropped because the writer is behind.
+
+int CaptureFrame(capture *Capture, framebuffer *Target) {
+
+    ++Capture->Captured;
+
+    int Slot = GetPushSlot(&Capture->Ring, Capture->Capacity);
+    if(Slot < 0) {
+        ++Capture->Dropped;
+        return 0;
+    }
+
+    memcpy(Capture->Frames[Slot], Target->Pixels, (size_t)Capture->Width * Capture->Height * 4);
+    FinishPush(&Capture->Ring);
+
+    uint32_t Queued = atomic_load(&Capture->Ring.Tail) - atomic_load(&Capture->Ring.Head);
+    if((int)Queued > Capture->MaxQueued) Capture->MaxQueued = (int)Queued;
+
+    pthread_mutex_lock(&Capture->Mutex);
+    pthread_cond_signal(&Capture->Wake);
+    pthread_mutex_unlock(&Capture->Mutex);
+    return 1;
+}
+
+// Waits for the writer to finish what is queued and closes the file.
+// Returns 0 if anything could not be written.
+
+int StopCapture(capture *Capture) {
+
+    pthread_mutex_lock(&Capture->Mutex);
+    Capture->Quit = 1;
+    pthread_cond_signal(&Capture->Wake);
+    pthread_mutex_unlock(&Capture->Mutex);
+    pthread_join(Capture->Thread, 0);
+
+    if(fclose(Capture->File)) Capture->Failed = 1;
+    Capture->File = 0;
+
+    pthread_mutex_destroy(&Capture->Mutex);
+    pthread_cond_destroy(&Capture->Wake);
+    FreeCaptureBuffers(Capture);
+    return !Capture->Failed;
+}
+
+#endif
@@ -0,0 +1,140 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+// Nanosecond time. GetMonotonicNanoseconds() reads the OS clock,
+// QueryPerformanceCounter on Windows and CLOCK_MONOTONIC elsewhere.
+// Everything else reads time through a gameClock. A virtual clock only
+// moves when AdvanceClock() is called, so headless runs can fast
+// forward through hours of frames and get the same results every time.
+//
+// Time is kept in unsigned 64 bit nanoseconds, which lasts 584 years.
+
+#include <stdint.h>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#define NANOSECONDS_PER_SECOND 1000000000ull
+
+typedef struct {
+    int Virtual;
+    uint64_t Now; // virtual clocks only
+} gameClock;
+
+// The real clock, for everything that has no reason to use another one
+gameClock RealClock = {0};
+
+uint64_t GetMonotonicNanoseconds() {
+#ifdef _WIN32
+    static LARGE_INTEGER Frequency;
+    if(!Frequency.QuadPart) {
+        QueryPerformanceFrequency(&Frequency);
+    }
+    LARGE_INTEGER Counter;
+    QueryPerformanceCounter(&Counter);
+
+    // Whole seconds and the rest separately, Counter * 1e9 would
+    // overflow after a few weeks of uptime at 10 MHz
+    uint64_t Seconds = (uint64_t)Counter.QuadPart / Frequency.QuadPart;
+    uint64_t Rest = (uint64_t)Counter.QuadPart % Frequency.QuadPart;
+    return Seconds * NANOSECONDS_PER_SECOND + Rest * NANOSECONDS_PER_SECOND / Frequency.QuadPart;
+#else
+    struct timespec Time;
+    clock_gettime(CLOCK_MONOTONIC, &Time);
+    return (uint64_t)Time.tv_sec * NANOSECONDS_PER_SECOND + (uint64_t)Time.tv_nsec;
+#endif
+}
+
+gameClock CreateVirtualClock(uint64_t Start) {
+    return (gameClock){.Virtual = 1, .Now = Start};
+}
+
+uint64_t ReadClock(gameClock *Clock) {
+    return Clock->Virtual ? Clock->Now : GetMonotonicNanoseconds();
+}
+
+void AdvanceClock(gameClock *Clock, uint64_t Nanoseconds) {
+    Clock->Now += Nanoseconds;
+}
+
+double NanosecondsToSeconds(uint64_t Nanoseconds) {
+    return (double)Nanoseconds / 1e9;
+}
+
+// Timer
+
+typedef struct {
+    gameClock *Clock;
+    uint64_t Start;
+    uint64_t Elapsed; // ns between the last StartTimer() and UpdateTimer()
+} timer;
+
+void StartTimer(timer *Timer) {
+    Timer->Start = ReadClock(Timer->Clock);
+}
+
+void UpdateTimer(timer *Timer) {
+    Timer->Elapsed = ReadClock(Timer->Clock) - Timer->Start;
+}
+
+// Elapsed time since the last lap or start, and starts the next lap at
+// the same instant so no time falls between laps
+uint64_t LapTimer(timer *Timer) {
+    uint64_t Now = ReadClock(Timer->Clock);
+    Timer->Elapsed = Now - Timer->Start;
+    Timer->Start = Now;
+    return Timer->Elapsed;
+}
+
+void InitTimer(timer *Timer, gameClock *Clock) {
+    Timer->Clock = Clock;
+    Timer->Elapsed = 0;
+    StartTimer(Timer);
+}
+
+// Fixed steps
+
+// Turns elapsed time into a number of fixed steps at Rate steps per
+// second. Steps are counted from the total time so far instead of
+// subtracting a rounded step length from an accumulator, so rounding
+// never builds up: after N seconds exactly N * Rate steps have been
+// due, however the time was split into frames.
+
+typedef struct {
+    uint32_t Rate;
+    uint64_t Elapsed;
+    uint64_t Steps;
+} stepClock;
+
+stepClock CreateStepClock(uint32_t Rate) {
+    return (stepClock){.Rate = Rate};
+}
+
+// Adds Nanoseconds and returns how many steps became due
+uint64_t AdvanceSteps(stepClock *Clock, uint64_t Nanoseconds) {
+    Clock->Elapsed += Nanoseconds;
+
+    // Elapsed * Rate split like above so it cannot overflow
+    uint64_t Seconds = Clock->Elapsed / NANOSECONDS_PER_SECOND;
+    uint64_t Rest = Clock->Elapsed % NANOSECONDS_PER_SECOND;
+    uint64_t Due = Seconds * Clock->Rate + Rest * Clock->Rate / NANOSECONDS_PER_SECOND;
+
+    uint64_t Steps = Due - Clock->Steps;
+    Clock->Steps = Due;
+    return Steps;
+}
+
+// How far into the next step the time is, 0 <= Alpha < 1
+float GetStepAlpha(stepClock *Clock) {
+    uint64_t Rest = Clock->Elapsed % NANOSECONDS_PER_SECOND;
+    uint64_t Partial = Rest * Clock->Rate % NANOSECONDS_PER_SECOND;
+    return (float)((double)Partial / 1e9);
+}
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef CORE_H
+#define CORE_H
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct { float X, Y, Z; } v3;
+typedef struct { float R, G, B, A; } color;
+typedef struct { float M[4][4]; } matrix;
+
+// Math
+
+v3 AddV3(v3 A, v3 B) {
+    v3 Result = {0};
+    Result.X += A.X + B.X;
+    Result.Y += A.Y + B.Y;
+    Result.Z += A.Z + B.Z;
+    return Result;
+}
+
+v3 AddV3Scalar(v3 A, float B) {
+    v3 Result = {0};
+    Result.X += A.X + B;
+    Result.Y += A.Y + B;
+    Result.Z += A.Z + B;
+    return Result;
+}
+
+v3 MultiplyV3Scalar(v3 A, float B) {
+    v3 Result = {0};
+    Result.X = A.X * B;
+    Result.Y = A.Y * B;
+    Result.Z = A.Z * B;
+    return Result;
+}
+
+v3 LerpV3(v3 A, v3 B, float T) {
+    v3 Result = {0};
+    Result.X = A.X + (B.X - A.X) * T;
+    Result.Y = A.Y + (B.Y - A.Y) * T;
+    Result.Z = A.Z + (B.Z - A.Z) * T;
+    return Result;
+}
+
+int IsZeroV3(v3 Vector) {
+    if(Vector.X == 0.0f &&
+       Vector.Y == 0.0f &&
+       Vector.Z == 0.0f) {
+        return 1;
+    }
+    return 0;
+}
+
+int CompareV3(v3 A, v3 B) {
+    if(A.X == B.X &&
+       A.Y == B.Y &&
+       A.Z == B.Z) {
+        return 1;
+    }
+    return 0;
+}
+
+#endif
@@ -1,14 +1,18 @@
 #define WIN32_LEAN_AND_MEAN
 #define COBJMACROS
 #include <stdio.h>
+#include <stddef.h>
 #include <windows.h>
 #include <d3d11_1.h>
+#include <dxgi1_5.h>
 #include <assert.h>
 #include <time.h>
 
-typedef struct { float X, Y, Z; } v3;
-typedef struct { float R, G, B, A; } color;
-typedef struct { float M[4][4]; } matrix;
+#include "render.h"
+#include "clock.h"
+#include "profile.h"
+#include "events.h"
+#include "pacing.h"
 
 typedef struct {
     ID3D11Buffer* Buffer;
@@ -18,37 +22,31 @@ typedef struct {
 } mesh;
 
 typedef struct {
-    matrix Model;
-    matrix View;
-    matrix Projection;
-    color Color;
+    matrix ViewProjection;
 } constants;
 
-typedef struct {
-    LARGE_INTEGER StartingCount;
-    LARGE_INTEGER EndingCount;
-    LARGE_INTEGER TotalCount;
-    LARGE_INTEGER CountsPerSecond;
-    double ElapsedMilliSeconds;
-} timer;
-
 // Globals
 
-float DeltaTime = 1.0f / 60.0f;
-
-mesh MeshRectangle;
+mesh Meshes[MESH_COUNT];
 
 v3 CameraPosition = {25.0f, 30.0f, -35.0f};
 
 enum {
-    UP, LEFT, DOWN, RIGHT, SPACE, 
-    W, A, S, D, Q, E, P, M, 
+    UP, LEFT, DOWN, RIGHT,
+    W, A, S, D, Q, E, H, V, I,
     KEYSAMOUNT
 };
 
 int KeyDown[KEYSAMOUNT];
 int KeyPressed[KEYSAMOUNT];
 
+// Flap, pause and practice mode presses and releases with the time the
+// window procedure saw them
+inputQueue InputQueue;
+
+// Starts frames and picks the present sync interval, V cycles the mode
+pacer Pacer;
+
 int Running = 1;
 
 int WindowWidth = 400;
@@ -64,25 +62,29 @@ ID3D11Device1* Device;
 ID3D11DeviceContext1* Context;
 ID3D11Buffer* Buffer;
 ID3D11Buffer* ConstantBuffer;
+ID3D11Buffer* InstanceBuffer;
 
 matrix ProjectionMatrix;
 matrix ViewMatrix;
 
+// Steps run by the frame being drawn, set by Update(). Presenting it
+// only shows the presses those steps handled.
+uint64_t ShownStep;
+
 // Declarations
 
 void Init();
 void Input();
 void Update();
 void Draw();
+void Shutdown();
 
-void DrawOne(v3 Position, color Color, mesh Mesh);
+void SubmitCommands(commandList *Commands);
+void *CreateHighResolutionTimer();
+void WindowsSleep(void *Context, uint64_t Nanoseconds);
+void WindowsSpin(void *Context);
 void Debug(char *Format, ...);
 
-v3 AddV3(v3 A, v3 B);
-int IsZeroV3(v3 Vector);
-int CompareV3(v3 A, v3 B);
-int IsOppositeV3(v3 A, v3 B);
-
 LRESULT CALLBACK WindowProc(HWND Window, UINT Message, WPARAM WParam, LPARAM LParam);
 
 mesh CreateMesh(float *Vertices,
@@ -92,7 +94,7 @@ mesh CreateMesh(float *Vertices,
     
     mesh Mesh = {0};
     Mesh.Stride = Stride * sizeof(float);
-    Mesh.NumVertices = Size / Stride;
+    Mesh.NumVertices = Size / Mesh.Stride;
     Mesh.Offset = Offset;
     
     D3D11_BUFFER_DESC BufferDesc = {
@@ -111,36 +113,50 @@ mesh CreateMesh(float *Vertices,
     return Mesh;
 }
 
-void DrawOne(v3 Position, color Color, mesh Mesh) {
-    ID3D11DeviceContext1_IASetPrimitiveTopology(Context, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-    ID3D11DeviceContext1_IASetVertexBuffers(Context, 0, 1, &Mesh.Buffer, &Mesh.Stride, &Mesh.Offset);
+// Uploads every instance of the frame with one map and issues one
+// instanced draw per batch.
+
+void SubmitCommands(commandList *Commands) {
     
     D3D11_MAPPED_SUBRESOURCE MappedSubresource;
     
     ID3D11DeviceContext1_Map(Context, (ID3D11Resource*)ConstantBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &MappedSubresource);
     constants* Constants = (constants*)MappedSubresource.pData;
-    Constants->Model = (matrix){
-        1.0f, 0.0f, 0.0f, 0.0f, 
-        0.0f, 1.0f, 0.0f, 0.0f, 
-        0.0f, 0.0f, 1.0f, 0.0f, 
-        Position.X, 
-        Position.Y, 
-        Position.Z, 1.0f
-    };
+    Constants->ViewProjection = Commands->ViewProjection;
+    ID3D11DeviceContext1_Unmap(Context, (ID3D11Resource*)ConstantBuffer, 0);
     
-    Constants->View = ViewMatrix;
-    Constants->Projection = ProjectionMatrix;
-    Constants->Color = Color;
+    PROFILE_COUNT("draws", Commands->BatchCount);
+    PROFILE_COUNT("instances", Commands->InstanceCount);
     
-    ID3D11DeviceContext1_Unmap(Context, (ID3D11Resource*)ConstantBuffer, 0);
-    ID3D11DeviceContext1_Draw(Context, Mesh.NumVertices, 0);
+    if(!Commands->InstanceCount) return;
+
+    ID3D11DeviceContext1_Map(Context, (ID3D11Resource*)InstanceBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &MappedSubresource);
+    memcpy(MappedSubresource.pData, Commands->Instances, Commands->InstanceCount * sizeof(instance));
+    ID3D11DeviceContext1_Unmap(Context, (ID3D11Resource*)InstanceBuffer, 0);
+
+    ID3D11DeviceContext1_IASetPrimitiveTopology(Context, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+    for(int Index = 0; Index < Commands->BatchCount; ++Index) {
+        drawBatch *Batch = &Commands->Batches[Index];
+        mesh *Mesh = &Meshes[Batch->Mesh];
+
+        ID3D11Buffer* Buffers[] = {Mesh->Buffer, InstanceBuffer};
+        UINT Strides[] = {Mesh->Stride, sizeof(instance)};
+        UINT Offsets[] = {Mesh->Offset, 0};
+
+        ID3D11DeviceContext1_IASetVertexBuffers(Context, 0, 2, Buffers, Strides, Offsets);
+        if(Batch->VertexCount) {
+            ID3D11DeviceContext1_DrawInstanced(Context, Batch->VertexCount, Batch->Count,
+                                               Batch->FirstVertex, Batch->First);
+        } else {
+            ID3D11DeviceContext1_DrawInstanced(Context, Mesh->NumVertices, Batch->Count, 0, Batch->First);
+        }
+    }
 }
 
 int WINAPI 
 WinMain(HINSTANCE Instance, HINSTANCE PrevInstance, PSTR CmdLine, int CmdShow) {
     
-    srand(time(NULL));
-    
     WNDCLASS WindowClass = {0};
     const char ClassName[] = "Window";
     WindowClass.lpfnWndProc = WindowProc;
@@ -231,6 +247,22 @@ WinMain(HINSTANCE Instance, HINSTANCE PrevInstance, PSTR CmdLine, int CmdShow) {
     assert(SUCCEEDED(Result));
     IDXGIAdapter_Release(DxgiAdapter);
     
+    // Tearing lets uncapped and target FPS frames show at once instead
+    // of at the next vertical blank
+
+    BOOL AllowTearing = FALSE;
+    IDXGIFactory5* DxgiFactory5;
+    if(SUCCEEDED(IDXGIFactory2_QueryInterface(DxgiFactory, &IID_IDXGIFactory5, (void**)&DxgiFactory5))) {
+        if(FAILED(IDXGIFactory5_CheckFeatureSupport(DxgiFactory5, DXGI_FEATURE_PRESENT_ALLOW_TEARING,
+                                                    &AllowTearing, sizeof(AllowTearing)))) {
+            AllowTearing = FALSE;
+        }
+        IDXGIFactory5_Release(DxgiFactory5);
+    }
+
+    // Flip model with a frame latency waitable object, so at most one
+    // frame is queued and the loop knows when the display took it
+
     DXGI_SWAP_CHAIN_DESC1 SwapChainDesc = {0};
     SwapChainDesc.Width = 0;
     SwapChainDesc.Height = 0;
@@ -238,11 +270,14 @@ WinMain(HINSTANCE Instance, HINSTANCE PrevInstance, PSTR CmdLine, int CmdShow) {
     SwapChainDesc.SampleDesc.Count = 1;
     SwapChainDesc.SampleDesc.Quality = 0;
     SwapChainDesc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
-    SwapChainDesc.BufferCount = 1;
+    SwapChainDesc.BufferCount = 2;
     SwapChainDesc.Scaling = DXGI_SCALING_STRETCH;
-    SwapChainDesc.SwapEffect = DXGI_SWAP_EFFECT_DISCARD;
+    SwapChainDesc.SwapEffect = DXGI_SWAP_EFFECT_FLIP_DISCARD;
     SwapChainDesc.AlphaMode = DXGI_ALPHA_MODE_UNSPECIFIED;
-    SwapChainDesc.Flags = 0;
+    SwapChainDesc.Flags = DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT;
+    if(AllowTearing) {
+        SwapChainDesc.Flags |= DXGI_SWAP_CHAIN_FLAG_ALLOW_TEARING;
+    }
     
     IDXGISwapChain1* SwapChain;
     Result = IDXGIFactory2_CreateSwapChainForHwnd(DxgiFactory, (IUnknown*)Device, Window,
@@ -250,6 +285,13 @@ WinMain(HINSTANCE Instance, HINSTANCE PrevInstance, PSTR CmdLine, int CmdShow) {
     assert(SUCCEEDED(Result));
     IDXGIFactory2_Release(DxgiFactory);
     
+    IDXGISwapChain2* SwapChain2;
+    Result = IDXGISwapChain1_QueryInterface(SwapChain, &IID_IDXGISwapChain2, (void**)&SwapChain2);
+    assert(SUCCEEDED(Result));
+    IDXGISwapChain2_SetMaximumFrameLatency(SwapChain2, 1);
+    HANDLE FrameLatencyWaitable = IDXGISwapChain2_GetFrameLatencyWaitableObject(SwapChain2);
+    IDXGISwapChain2_Release(SwapChain2);
+
     // Render target view
     
     ID3D11Texture2D* FrameBuffer;
@@ -288,8 +330,23 @@ WinMain(HINSTANCE Instance, HINSTANCE PrevInstance, PSTR CmdLine, int CmdShow) {
     D3D11_INPUT_ELEMENT_DESC InputElementDesc[] = {
         {
             "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 
-            0, 0, 
+            0, offsetof(vertex, Position),
+            D3D11_INPUT_PER_VERTEX_DATA, 0
+        },
+        {
+            "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT,
+            0, offsetof(vertex, Color),
             D3D11_INPUT_PER_VERTEX_DATA, 0
+        },
+        {
+            "INSTANCE_POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT,
+            1, offsetof(instance, Position),
+            D3D11_INPUT_PER_INSTANCE_DATA, 1
+        },
+        {
+            "INSTANCE_COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT,
+            1, offsetof(instance, Color),
+            D3D11_INPUT_PER_INSTANCE_DATA, 1
         }
     };
     
@@ -315,6 +372,17 @@ WinMain(HINSTANCE Instance, HINSTANCE PrevInstance, PSTR CmdLine, int CmdShow) {
     Result = ID3D11Device1_CreateBuffer(Device, &ConstantBufferDesc, NULL, &ConstantBuffer);
     assert(SUCCEEDED(Result));
     
+    // Instance buffer
+
+    D3D11_BUFFER_DESC InstanceBufferDesc = {0};
+    InstanceBufferDesc.ByteWidth  = MAX_INSTANCES * sizeof(instance);
+    InstanceBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+    InstanceBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+    InstanceBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+
+    Result = ID3D11Device1_CreateBuffer(Device, &InstanceBufferDesc, NULL, &InstanceBuffer);
+    assert(SUCCEEDED(Result));
+
     // Viewport
     
     Viewport = (D3D11_VIEWPORT){
@@ -330,48 +398,66 @@ WinMain(HINSTANCE Instance, HINSTANCE PrevInstance, PSTR CmdLine, int CmdShow) {
     float Near = 1.0f;
     float Far = 100.0f;
     
-    ProjectionMatrix = (matrix){
-        2.0f * Near / AspectRatio, 0.0f, 0.0f, 0.0f, 
-        0.0f, 2.0f * Near / Height, 0.0f, 0.0f, 
-        0.0f, 0.0f, Far / (Far - Near), 1.0f, 
-        0.0f, 0.0f, Near * Far / (Near - Far), 0.0f 
-    };
+    ProjectionMatrix = GetProjectionMatrix(AspectRatio, Height, Near, Far);
     
     // View matrix
     
-    ViewMatrix = (matrix){
-        1.0f, 0.0f, 0.0f, 0.0f,
-        0.0f, 1.0f, 0.0f, 0.0f,
-        0.0f, 0.0f, 1.0f, 0.0f,
-        -CameraPosition.X, -CameraPosition.Y, -CameraPosition.Z, 1.0f,
-    };
+    ViewMatrix = GetViewMatrix(CameraPosition);
     
-    // Default meshes
+    // Meshes
     
-    float RectangleVertexData[] = {
-        -0.5f, -0.5f, 0.0f,
-        -0.5f, 0.5f, 0.0f,
-        0.5f, 0.5f, 0.0f,
-        -0.5f, -0.5f, 0.0f,
-        0.5f, 0.5f, 0.0f,
-        0.5f, -0.5f, 0.0f,
-    };
+    InitMeshData();
     
-    MeshRectangle = CreateMesh(RectangleVertexData, sizeof(RectangleVertexData),
-                               3, 0);
+    for(int Index = 0; Index < MESH_BACKGROUND; ++Index) {
+        Meshes[Index] = CreateMesh((float*)MeshData[Index].Vertices,
+                                   MeshData[Index].VertexCount * sizeof(vertex),
+                                   sizeof(vertex) / sizeof(float), 0);
+    }
+
+#ifdef PROFILE
+    InitProfiler(&Profiler);
+#endif
+
+    // Pacing
+
+    DEVMODE DisplayMode = {.dmSize = sizeof(DEVMODE)};
+    DWORD RefreshRate = 60;
+    if(EnumDisplaySettings(0, ENUM_CURRENT_SETTINGS, &DisplayMode) && DisplayMode.dmDisplayFrequency > 1) {
+        RefreshRate = DisplayMode.dmDisplayFrequency;
+    }
+
+    pacingPlatform PacingPlatform = {WindowsSleep, WindowsSpin, CreateHighResolutionTimer()};
+    InitPacer(&Pacer, PACING_VSYNC, &RealClock, PacingPlatform, NANOSECONDS_PER_SECOND / RefreshRate);
     
     Init();
     
     while(Running) {
+        PROFILE_BEGIN("Wait");
+        WaitForSingleObjectEx(FrameLatencyWaitable, 1000, TRUE);
+        if(GetPresentInterval(&Pacer)) {
+            MarkVBlank(&Pacer, GetMonotonicNanoseconds());
+        }
+        BeginFrame(&Pacer);
+        PROFILE_END();
+
+        PROFILE_BEGIN("Messages");
         MSG Message;
         while(PeekMessage(&Message, NULL, 0, 0, PM_REMOVE)) {
             if(Message.message == WM_QUIT) Running = 0;
             TranslateMessage(&Message);
             DispatchMessage(&Message);
         }
+        PROFILE_END();
         
+        PROFILE_BEGIN("Input");
         Input();
+        PROFILE_END();
+
+        PROFILE_BEGIN("Update");
         Update();
+        PROFILE_END();
+
+        PROFILE_BEGIN("Draw");
         
         // Clear
         
@@ -388,20 +474,70 @@ WinMain(HINSTANCE Instance, HINSTANCE PrevInstance, PSTR CmdLine, int CmdShow) {
         ID3D11DeviceContext1_PSSetShader(Context, PixelShader, 0, 0);
         
         Draw();
+        PROFILE_END();
         
         // Swap
         
-        IDXGISwapChain1_Present(SwapChain, 1, 0);
+        PROFILE_BEGIN("Present");
+        EndFrameWork(&Pacer);
+        UINT SyncInterval = GetPresentInterval(&Pacer);
+        UINT PresentFlags = (!SyncInterval && AllowTearing) ? DXGI_PRESENT_ALLOW_TEARING : 0;
+        IDXGISwapChain1_Present(SwapChain, SyncInterval, PresentFlags);
+        PROFILE_END();
+
+        MarkPresentedThrough(&InputQueue, GetMonotonicNanoseconds(), ShownStep);
         
+        PROFILE_FRAME();
     }
     
+    Shutdown();
+
     return 0;
 }
 
+// Pacing platform. Sleeps on a high resolution waitable timer where
+// there is one (Windows 10 1803 and later), Sleep() otherwise, which
+// may oversleep by a whole scheduler tick.
+
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+void *CreateHighResolutionTimer() {
+    return CreateWaitableTimerExW(0, 0, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+}
+
+void WindowsSleep(void *Context, uint64_t Nanoseconds) {
+    HANDLE Timer = Context;
+    LARGE_INTEGER DueTime = {.QuadPart = -(LONGLONG)(Nanoseconds / 100)};
+    if(Timer && SetWaitableTimer(Timer, &DueTime, 0, 0, 0, FALSE)) {
+        WaitForSingleObject(Timer, INFINITE);
+    } else {
+        Sleep((DWORD)(Nanoseconds / 1000000));
+    }
+}
+
+void WindowsSpin(void *Context) {
+    YieldProcessor();
+}
+
 int IsRepeat(LPARAM LParam) {
     return (HIWORD(LParam) & KF_REPEAT);
 }
 
+// Messages are only handled once per frame, so the event is dated back
+// by how long the message waited, at the millisecond resolution of
+// GetMessageTime(). Key up messages always count as repeats, so only
+// presses are filtered.
+
+void PushKeyEvent(int Action, int IsKeyDown, LPARAM LParam) {
+    if(IsKeyDown && IsRepeat(LParam)) return;
+
+    uint64_t Now = GetMonotonicNanoseconds();
+    uint64_t Age = (uint64_t)(DWORD)(GetTickCount() - (DWORD)GetMessageTime()) * 1000000;
+    PushInputEvent(&InputQueue, Action, IsKeyDown, Age < Now ? Now - Age : Now);
+}
+
 LRESULT CALLBACK 
 WindowProc(HWND Window, UINT Message, WPARAM WParam, LPARAM LParam) {
     switch(Message) {
@@ -428,16 +564,27 @@ WindowProc(HWND Window, UINT Message, WPARAM WParam, LPARAM LParam) {
                     KeyDown[E] = IsKeyDown;
                 } break;
                 case VK_SPACE: {
-                    KeyDown[SPACE] = IsKeyDown;
+                    PushKeyEvent(ACTION_FLAP, IsKeyDown, LParam);
                 } break;
                 case 'P': {
-                    if(IsKeyDown && !IsRepeat(LParam)) {
-                        KeyPressed[P] = 1;
-                    } 
+                    PushKeyEvent(ACTION_PAUSE, IsKeyDown, LParam);
                 } break;
                 case 'M': {
+                    PushKeyEvent(ACTION_PRACTICE_MODE, IsKeyDown, LParam);
+                } break;
+                case 'H': {
+                    if(IsKeyDown && !IsRepeat(LParam)) {
+                        KeyPressed[H] = 1;
+                    }
+                } break;
+                case 'V': {
+                    if(IsKeyDown && !IsRepeat(LParam)) {
+                        KeyPressed[V] = 1;
+                    }
+                } break;
+                case 'I': {
                     if(IsKeyDown && !IsRepeat(LParam)) {
-                        KeyPressed[M] = 1;
+                        KeyPressed[I] = 1;
                     }
                 } break;
                 case 'O': { 
@@ -456,97 +603,8 @@ WindowProc(HWND Window, UINT Message, WPARAM WParam, LPARAM LParam) {
 }
 
 
-// Timer
-
-void StartTimer(timer *Timer) {
-    QueryPerformanceCounter(&Timer->StartingCount);
-}
-
-void UpdateTimer(timer *Timer) {
-    // get current tick
-    QueryPerformanceCounter(&Timer->EndingCount);
-    // get tick count
-    Timer->TotalCount.QuadPart = Timer->EndingCount.QuadPart - Timer->StartingCount.QuadPart;
-    // for precision
-    Timer->TotalCount.QuadPart *= 1000000;
-    // calculate elapsed milliseconds
-    Timer->ElapsedMilliSeconds = (double)(Timer->TotalCount.QuadPart / Timer->CountsPerSecond.QuadPart) / 1000;
-}
-
-DWORD InitTimer(timer *Timer) {
-    if(!QueryPerformanceFrequency(&Timer->CountsPerSecond)) {
-        return GetLastError();
-    }
-    StartTimer(Timer);
-    return 0;
-}
-
 // Misc
 
-v3 AddV3(v3 A, v3 B) {
-    v3 Result = {0};
-    Result.X += A.X + B.X;
-    Result.Y += A.Y + B.Y;
-    Result.Z += A.Z + B.Z;
-    return Result;
-}
-
-v3 AddV3Scalar(v3 A, float B) {
-    v3 Result = {0};
-    Result.X += A.X + B;
-    Result.Y += A.Y + B;
-    Result.Z += A.Z + B;
-    return Result;
-}
-
-v3 MultiplyV3Scalar(v3 A, float B) {
-    v3 Result = {0};
-    Result.X = A.X * B;
-    Result.Y = A.Y * B;
-    Result.Z = A.Z * B;
-    return Result;
-}
-
-int IsZeroV3(v3 Vector) {
-    if(Vector.X == 0.0f &&
-       Vector.Y == 0.0f &&
-       Vector.Z == 0.0f) {
-        return 1; 
-    }
-    return 0;
-}
-
-int CompareV3(v3 A, v3 B) {
-    if(A.X == B.X &&
-       A.Y == B.Y &&
-       A.Z == B.Z) {
-        return 1; 
-    }
-    return 0;
-}
-
-
-float GetRandomZeroToOne() {
-    return (float)rand() / (float)RAND_MAX ;
-}
-
-color GetRandomColor() {
-    return (color){
-        GetRandomZeroToOne(),
-        GetRandomZeroToOne(),
-        GetRandomZeroToOne(),
-    };
-}
-
-color GetRandomShadeOfGray() {
-    float Shade = GetRandomZeroToOne();
-    return (color){
-        Shade,
-        Shade,
-        Shade,
-    };
-}
-
 void Debug(char *Format, ...) {
     va_list Arguments;
     va_start(Arguments, Format);
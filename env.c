@@ -0,0 +1,55 @@
+#include "env.h"
+
+// Shared library build of env.h for trainers in other languages:
+//
+//     cc env.c -o libenv.so -shared -fPIC -O2 -std=c11 -pthread
+//
+// The environment stays opaque behind a pointer. From Python with
+// ctypes and NumPy, with the argument types declared: ctypes passes
+// plain Python ints as C int, which cuts 64-bit addresses short.
+//
+//     Lib = ctypes.CDLL("./libenv.so")
+//     Pointer = ctypes.c_void_p
+//     Lib.NewEnvironment.restype = Pointer
+//     Lib.NewEnvironment.argtypes = [ctypes.c_int, ctypes.c_uint, ctypes.c_int]
+//     Lib.SetEnvironmentBuffers.argtypes = [Pointer, Pointer, Pointer, Pointer]
+//     Lib.ResetEnvironment.argtypes = [Pointer]
+//     Lib.StepEnvironment.argtypes = [Pointer, Pointer]
+//     Lib.DeleteEnvironment.argtypes = [Pointer]
+//
+//     Env = Lib.NewEnvironment(Count, Seed, Threads)
+//     Observations = numpy.zeros((Count, Lib.GetObservationSize()), numpy.float32)
+//     Rewards = numpy.zeros(Count, numpy.float32)
+//     Dones = numpy.zeros(Count, numpy.uint8)
+//     Actions = numpy.zeros(Count, numpy.uint8)
+//     Lib.SetEnvironmentBuffers(Env, Observations.ctypes.data, Rewards.ctypes.data, Dones.ctypes.data)
+//     Lib.ResetEnvironment(Env)
+//     Lib.StepEnvironment(Env, Actions.ctypes.data)  # one action per world
+//     Lib.DeleteEnvironment(Env)
+//
+// The arrays must stay alive and in place while the environment uses
+// them.
+
+// The job pool inside has cache line aligned counters, more than
+// malloc() promises, and aligned_alloc() wants a multiple of the
+// alignment.
+
+environment *NewEnvironment(int Count, unsigned int Seed, int Threads) {
+    size_t Size = (sizeof(environment) + 63) & ~(size_t)63;
+    environment *Env = aligned_alloc(64, Size);
+    if(Env && !CreateEnvironment(Env, Count, Seed, Threads)) {
+        free(Env);
+        Env = 0;
+    }
+    return Env;
+}
+
+void DeleteEnvironment(environment *Env) {
+    if(!Env) return;
+    FreeEnvironment(Env);
+    free(Env);
+}
+
+int GetObservationSize() {
+    return ENV_OBSERVATION_SIZE;
+}
@@ -0,0 +1,157 @@
+#ifndef ENV_H
+#define ENV_H
+
+// Reinforcement learning environment over a worldBatch. The caller
+// owns the observation, reward and done buffers, hands them over once
+// with SetEnvironmentBuffers() and reads them after every
+// ResetEnvironment() and StepEnvironment(). Nothing is copied in
+// between, so NumPy arrays can be passed straight through.
+//
+// Per world the observation is ENV_OBSERVATION_SIZE floats in world
+// units:
+//
+//     0  bird Y
+//     1  bird velocity
+//     2  per pipe pair ahead of the bird, nearest first:
+//        distance from the bird, bottom of the gap, top of the gap
+//
+// Missing pairs read as a pair far away with a centered gap. A world
+// is done when it hits a pipe or leaves [BotFloorY, BotCeilingY], the
+// game itself has no floor. A done world is reset in the same step, so
+// its observation already belongs to the next episode while its reward
+// and done flag belong to the one that ended.
+
+#include "batch.h"
+#include "jobs.h"
+
+#define ENV_PIPE_PAIRS 2
+#define ENV_OBSERVATION_SIZE (2 + 3 * ENV_PIPE_PAIRS)
+
+float EnvNoPipeDistance = 100.0f;
+
+float EnvPassReward = 1.0f;    // per pipe pair passed
+float EnvAliveReward = 0.01f;  // per step survived
+float EnvDoneReward = -1.0f;
+
+int EnvChunkSize = 256;
+
+typedef struct {
+    worldBatch Batch;
+    jobPool Pool;
+
+    unsigned char *Actions;
+    float *Observations;  // Count * ENV_OBSERVATION_SIZE
+    float *Rewards;       // Count
+    unsigned char *Dones; // Count
+} environment;
+
+int CreateEnvironment(environment *Env, int Count, unsigned int Seed, int Threads) {
+    memset(Env, 0, sizeof(*Env));
+    SelectKernels();
+    if(!CreateBatch(&Env->Batch, Count, Seed)) return 0;
+    CreateJobPool(&Env->Pool, Threads);
+    return 1;
+}
+
+void FreeEnvironment(environment *Env) {
+    DestroyJobPool(&Env->Pool);
+    FreeBatch(&Env->Batch);
+    memset(Env, 0, sizeof(*Env));
+}
+
+void SetEnvironmentBuffers(environment *Env, float *Observations, float *Rewards, unsigned char *Dones) {
+    Env->Observations = Observations;
+    Env->Rewards = Rewards;
+    Env->Dones = Dones;
+}
+
+void WriteObservation(worldBatch *Batch, int World, float *Observation) {
+
+    Observation[0] = Batch->BirdY[World];
+    Observation[1] = Batch->BirdVelocity[World];
+
+    // Bottom pipes sit at even slots with their top pipe right after
+    // them. Pairs still overlapping the bird count as ahead.
+
+    float *PipeX = Batch->PipeX + World * BATCH_PIPE_STRIDE;
+    float *PipeY = Batch->PipeY + World * BATCH_PIPE_STRIDE;
+    float Behind = BirdStartX - BirdWidth / 2.0f - PipeWidth / 2.0f;
+
+    int Pairs[ENV_PIPE_PAIRS];
+    int PairCount = 0;
+
+    for(int Slot = 0; Slot < MAX_PIPES_AMOUNT; Slot += 2) {
+        float X = PipeX[Slot];
+        if(X == BatchEmptyPipeX || X < Behind) continue;
+
+        // Insertion into the few nearest so far
+        int Index = PairCount < ENV_PIPE_PAIRS ? PairCount++ : ENV_PIPE_PAIRS;
+        while(Index > 0 && PipeX[Pairs[Index - 1]] > X) {
+            if(Index < ENV_PIPE_PAIRS) Pairs[Index] = Pairs[Index - 1];
+            --Index;
+        }
+        if(Index < ENV_PIPE_PAIRS) Pairs[Index] = Slot;
+    }
+
+    float *Pair = Observation + 2;
+    for(int Index = 0; Index < ENV_PIPE_PAIRS; ++Index, Pair += 3) {
+        if(Index < PairCount) {
+            int Slot = Pairs[Index];
+            Pair[0] = PipeX[Slot] - BirdStartX;
+            Pair[1] = PipeY[Slot] + PipeHeight / 2.0f;
+            Pair[2] = PipeY[Slot + 1] - PipeHeight / 2.0f;
+        } else {
+            Pair[0] = EnvNoPipeDistance;
+            Pair[1] = PipeStartY + PipeHeight / 2.0f;
+            Pair[2] = PipeStartY + PipeHeight / 2.0f + PipeVerticalSpace;
+        }
+    }
+}
+
+void ResetEnvironmentJob(void *Data, int First, int Last) {
+    environment *Env = Data;
+    for(int World = First; World < Last; ++World) {
+        ResetBatchWorld(&Env->Batch, World);
+        WriteObservation(&Env->Batch, World, Env->Observations + World * ENV_OBSERVATION_SIZE);
+    }
+}
+
+void StepEnvironmentJob(void *Data, int First, int Last) {
+    environment *Env = Data;
+    worldBatch *Batch = &Env->Batch;
+
+    // Rewards hold the score before the step until it is known
+    for(int World = First; World < Last; ++World) {
+        Env->Rewards[World] = (float)Batch->Score[World];
+    }
+
+    StepBatchRange(Batch, Env->Actions, First, Last);
+
+    for(int World = First; World < Last; ++World) {
+        float Y = Batch->BirdY[World];
+        int Done = Batch->Done[World] || Y < BotFloorY || Y > BotCeilingY;
+
+        float Passed = (float)Batch->Score[World] - Env->Rewards[World];
+        Env->Rewards[World] = Passed * EnvPassReward + (Done ? EnvDoneReward : EnvAliveReward);
+        Env->Dones[World] = (unsigned char)Done;
+
+        if(Done) {
+            if(!Batch->Done[World]) ++Batch->Episodes[World];
+            ResetBatchWorld(Batch, World);
+        }
+        WriteObservation(Batch, World, Env->Observations + World * ENV_OBSERVATION_SIZE);
+    }
+}
+
+// Starts a new episode in every world
+void ResetEnvironment(environment *Env) {
+    RunJob(&Env->Pool, ResetEnvironmentJob, Env, Env->Batch.Count, EnvChunkSize);
+}
+
+// Actions holds one flap flag per world
+void StepEnvironment(environment *Env, unsigned char *Actions) {
+    Env->Actions = Actions;
+    RunJob(&Env->Pool, StepEnvironmentJob, Env, Env->Batch.Count, EnvChunkSize);
+}
+
+#endif
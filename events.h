@@ -0,0 +1,227 @@
+#ifndef EVENTS_H
+#define EVENTS_H
+
+// Timestamped input. The window procedure pushes every press and
+// release of the game's buttons with the time it saw it. Each fixed
+// step then takes the events that happened up to its own point in time
+// instead of sampling key state once per frame:
+//
+// - a tap that is pressed and released between two steps still flaps
+//   on the next step
+// - when a frame runs several steps, an event is applied to the step it
+//   belongs to, not to the first one. The last step takes everything
+//   that is left, so no event waits for the next frame.
+//
+// Each flap press is timed twice. Input to simulation runs until the
+// step that applied it has run, input to present until the frame with
+// that step has been presented.
+//
+// Three parties touch a queue, and each may be on its own thread: the
+// window procedure pushes events, the simulation consumes them and
+// marks steps simulated, and the renderer marks frames presented. The
+// events and the simulated presses go through lock-free single producer
+// single consumer rings. Everything else belongs to one of them.
+
+#include <stdatomic.h>
+#include <stdint.h>
+
+#include "game.h"
+#include "clock.h"
+
+#define MAX_INPUT_EVENTS 256
+#define MAX_PENDING_PRESSES 64
+#define LATENCY_BUCKETS 200 // 0.5 ms each
+
+enum {
+    ACTION_FLAP,
+    ACTION_PAUSE,
+    ACTION_PRACTICE_MODE,
+    ACTION_COUNT,
+};
+
+typedef struct {
+    uint64_t Time;
+    int Action;
+    int Down;
+} inputEvent;
+
+// Flap press that a step has applied, Step counting MarkSimulated()
+// calls
+typedef struct {
+    uint64_t Time;
+    uint64_t Step;
+} simulatedPress;
+
+// Indices of a single producer single consumer ring over an array the
+// caller owns. Capacity has to be a power of two. Head and Tail only
+// ever grow, the producer writes Tail and the consumer Head, each on
+// its own cache line.
+typedef struct {
+    _Alignas(64) _Atomic uint32_t Head; // next to consume
+    _Alignas(64) _Atomic uint32_t Tail; // next to fill
+} spscRing;
+
+// Slot to fill next, -1 if the ring is full. FinishPush() hands it over.
+int GetPushSlot(spscRing *Ring, uint32_t Capacity) {
+    uint32_t Tail = atomic_load_explicit(&Ring->Tail, memory_order_relaxed);
+    uint32_t Head = atomic_load_explicit(&Ring->Head, memory_order_acquire);
+    return Tail - Head < Capacity ? (int)(Tail & (Capacity - 1)) : -1;
+}
+
+void FinishPush(spscRing *Ring) {
+    uint32_t Tail = atomic_load_explicit(&Ring->Tail, memory_order_relaxed);
+    atomic_store_explicit(&Ring->Tail, Tail + 1, memory_order_release);
+}
+
+// Slot to read next, -1 if the ring is empty. FinishPop() frees it.
+int GetPopSlot(spscRing *Ring, uint32_t Capacity) {
+    uint32_t Head = atomic_load_explicit(&Ring->Head, memory_order_relaxed);
+    uint32_t Tail = atomic_load_explicit(&Ring->Tail, memory_order_acquire);
+    return Head != Tail ? (int)(Head & (Capacity - 1)) : -1;
+}
+
+void FinishPop(spscRing *Ring) {
+    uint32_t Head = atomic_load_explicit(&Ring->Head, memory_order_relaxed);
+    atomic_store_explicit(&Ring->Head, Head + 1, memory_order_release);
+}
+
+typedef struct {
+    long Count;
+    uint64_t Total;
+    uint64_t Max;
+    long Buckets[LATENCY_BUCKETS];
+} latencyStats;
+
+typedef struct {
+
+    // Window procedure to simulation
+    inputEvent Events[MAX_INPUT_EVENTS];
+    spscRing EventRing;
+    long Dropped;
+
+    // Simulation
+    int Held[ACTION_COUNT];
+    int Pressed[ACTION_COUNT]; // since the last step
+    uint64_t Applied[MAX_PENDING_PRESSES]; // flap presses of this step
+    int AppliedCount;
+    uint64_t Steps;
+    latencyStats ToSimulation;
+
+    // Simulation to renderer, presses waiting for their frame
+    simulatedPress Simulated[MAX_PENDING_PRESSES];
+    spscRing SimulatedRing;
+
+    // Renderer
+    latencyStats ToPresent;
+} inputQueue;
+
+void PushInputEvent(inputQueue *Queue, int Action, int Down, uint64_t Time) {
+    int Slot = GetPushSlot(&Queue->EventRing, MAX_INPUT_EVENTS);
+    if(Slot < 0) {
+        ++Queue->Dropped;
+        return;
+    }
+    Queue->Events[Slot] = (inputEvent){Time, Action, Down};
+    FinishPush(&Queue->EventRing);
+}
+
+// Applies every event up to Time and returns the input for the step at
+// that time
+
+input ConsumeInput(inputQueue *Queue, uint64_t Time) {
+
+    int Slot;
+    while((Slot = GetPopSlot(&Queue->EventRing, MAX_INPUT_EVENTS)) >= 0) {
+        inputEvent *Event = &Queue->Events[Slot];
+        if(Event->Time > Time) break;
+
+        if(Event->Down && !Queue->Held[Event->Action]) {
+            Queue->Pressed[Event->Action] = 1;
+            if(Event->Action == ACTION_FLAP && Queue->AppliedCount < MAX_PENDING_PRESSES) {
+                Queue->Applied[Queue->AppliedCount++] = Event->Time;
+            }
+        }
+        Queue->Held[Event->Action] = Event->Down;
+        FinishPop(&Queue->EventRing);
+    }
+
+    input Input = {
+        .Flap = Queue->Held[ACTION_FLAP] || Queue->Pressed[ACTION_FLAP],
+        .TogglePause = Queue->Pressed[ACTION_PAUSE],
+        .TogglePracticeMode = Queue->Pressed[ACTION_PRACTICE_MODE],
+    };
+
+    memset(Queue->Pressed, 0, sizeof(Queue->Pressed));
+    return Input;
+}
+
+void AddLatency(latencyStats *Stats, uint64_t Latency) {
+    ++Stats->Count;
+    Stats->Total += Latency;
+    if(Latency > Stats->Max) Stats->Max = Latency;
+
+    uint64_t Bucket = Latency / 500000;
+    if(Bucket >= LATENCY_BUCKETS) Bucket = LATENCY_BUCKETS - 1;
+    ++Stats->Buckets[Bucket];
+}
+
+// Upper edge of the bucket holding the given percentile, in ms
+double GetLatencyPercentile(latencyStats *Stats, double Percent) {
+    long Rank = (long)(Percent / 100.0 * Stats->Count + 0.5);
+    long Seen = 0;
+    for(int Bucket = 0; Bucket < LATENCY_BUCKETS; ++Bucket) {
+        Seen += Stats->Buckets[Bucket];
+        if(Seen >= Rank && Seen > 0) return (Bucket + 1) * 0.5;
+    }
+    return LATENCY_BUCKETS * 0.5;
+}
+
+double GetLatencyMean(latencyStats *Stats) {
+    return Stats->Count ? Stats->Total / 1e6 / Stats->Count : 0.0;
+}
+
+// Call after the step that consumed the input has run. Returns the
+// number of the step, what MarkPresentedThrough() takes.
+
+uint64_t MarkSimulated(inputQueue *Queue, uint64_t Now) {
+    ++Queue->Steps;
+    for(int Index = 0; Index < Queue->AppliedCount; ++Index) {
+        AddLatency(&Queue->ToSimulation, Now - Queue->Applied[Index]);
+        int Slot = GetPushSlot(&Queue->SimulatedRing, MAX_PENDING_PRESSES);
+        if(Slot >= 0) {
+            Queue->Simulated[Slot] = (simulatedPress){Queue->Applied[Index], Queue->Steps};
+            FinishPush(&Queue->SimulatedRing);
+        }
+    }
+    Queue->AppliedCount = 0;
+    return Queue->Steps;
+}
+
+// Call once a frame showing every step up to Step is on screen
+void MarkPresentedThrough(inputQueue *Queue, uint64_t Now, uint64_t Step) {
+    int Slot;
+    while((Slot = GetPopSlot(&Queue->SimulatedRing, MAX_PENDING_PRESSES)) >= 0) {
+        simulatedPress *Press = &Queue->Simulated[Slot];
+        if(Press->Step > Step) break;
+        AddLatency(&Queue->ToPresent, Now - Press->Time);
+        FinishPop(&Queue->SimulatedRing);
+    }
+}
+
+// Same for a frame showing everything simulated so far
+void MarkPresented(inputQueue *Queue, uint64_t Now) {
+    MarkPresentedThrough(Queue, Now, UINT64_MAX);
+}
+
+// Real time at which step number Step of StepClock was due, given that
+// the clock's elapsed time was read at real time Now
+
+uint64_t GetStepRealTime(stepClock *Clock, uint64_t Step, uint64_t Now) {
+    uint64_t Seconds = Step / Clock->Rate;
+    uint64_t Rest = Step % Clock->Rate;
+    uint64_t Due = Seconds * NANOSECONDS_PER_SECOND +
+                   (Rest * NANOSECONDS_PER_SECOND + Clock->Rate - 1) / Clock->Rate;
+    return Now - (Clock->Elapsed - Due);
+}
+
+#endif
@@ -0,0 +1,296 @@
+#ifndef GAME_H
+#define GAME_H
+
+// Platform-free simulation: bird, pipes, trail and collision.
+// Everything the game needs lives in a world. The platform layer owns
+// the window, the timers and the renderer and only talks to the world
+// through InitWorld() and UpdateWorld().
+
+#include "core.h"
+#include "kernels.h"
+#include "random.h"
+
+#define MAX_TRAIL_LENGTH 15
+#define MAX_PIPES_AMOUNT 10
+
+// Pipes and trail are component stores: one array per field, each sized
+// to the store's capacity, with a ring telling which slot comes next.
+//
+// Trail pieces never change once added. They drift left with the pipes
+// and fade into the background, which the renderer works out from their
+// age, see particles.h.
+
+typedef struct {
+    int Length;
+    int Capacity;
+    int Index;
+} ring;
+
+typedef struct {
+    v3 Position;
+    v3 PreviousPosition;
+    v3 Velocity;
+    float MaxVelocity;
+} bird;
+
+typedef struct {
+    ring Ring;
+    float X[MAX_PIPES_AMOUNT];
+    float Y[MAX_PIPES_AMOUNT];
+    float PreviousX[MAX_PIPES_AMOUNT];
+    unsigned char Hit[MAX_PIPES_AMOUNT];
+} pipeStore;
+
+typedef struct {
+    ring Ring;
+    int SpawnTick[MAX_TRAIL_LENGTH];
+    float X[MAX_TRAIL_LENGTH];
+    float Y[MAX_TRAIL_LENGTH];
+} trailStore;
+
+typedef struct {
+    float Left;
+    float Right;
+    float Top;
+    float Bottom;
+} rectangle;
+
+// Everything the player can do in one step. The toggles flip pause and
+// practice mode at the start of the step, so a recorded input stream
+// replays to the same state.
+typedef struct {
+    int Flap;
+    int TogglePause;
+    int TogglePracticeMode;
+} input;
+
+typedef struct {
+    bird Bird;
+    pipeStore Pipes;
+    trailStore Trail;
+
+    unsigned int Seed;
+    random Random;
+
+    int Tick;
+    int PipeTicks;
+    int TrailTicks;
+
+    int Score;
+
+    int PracticeMode;
+    int Pause;
+    int Running;
+} world;
+
+// Globals
+
+// The simulation always advances in fixed steps of DeltaTime, spawning
+// is counted in those steps. Nothing here reads a clock.
+
+float DeltaTime = 1.0f / 60.0f;
+int StepsPerSecond = 60; // 1 / DeltaTime
+
+float Gravity = 9.81f;
+
+color ColorBird = {0.1f, 0.9f, 0.3f, 1.0f};
+color ColorPipe= {0.4f, 0.2f, 0.9f, 1.0f};
+color ColorPipePractice = {0.3f, 0.3f, 0.3f, 1.0f};
+color ColorPipeHit = {0.5f, 0.5f, 0.5f, 1.0f};
+color ColorBackground = {0.2f, 0.2f, 0.2f, 1.0f};
+color ColorBackgroundLighter = {0.21f, 0.21f, 0.21f, 1.0f};
+color ColorTrail = {0.3f, 0.3f, 0.3f, 1.0f};
+
+float PipeStartX = 45.0f;
+float PipeStartY = 10.0f;
+float PipeWidth = 4.0f;
+float PipeHeight = 25.0f;
+float PipeVerticalSpace = 10.0f;
+
+int   PipeSpawnTicks = 30; // 500 ms
+int   TrailSpawnTicks = 2; // ~30 ms
+
+float PipeSpeed = 20.0f;
+float BirdSpeed = 2.0f;
+
+float BirdStartX = 20.0f;
+float BirdStartY = 40.0f;
+float BirdMaxVelocity = 10.0f;
+float BirdWidth = 1.0f;
+float BirdHeight = 1.0f;
+
+// The game has no floor or ceiling, bots count leaving this as a crash
+float BotFloorY = 0.0f;
+float BotCeilingY = 60.0f;
+
+int RectanglesIntersect(rectangle* A, rectangle* B) {
+    if(A->Left > B->Right) return 0;
+    if(B->Left > A->Right) return 0;
+    if(A->Bottom > B->Top) return 0;
+    if(B->Bottom > A->Top) return 0;
+    return 1;
+}
+
+// Returns the slot to fill next. Once the ring is full the oldest slot
+// gets reused.
+
+int AddToRing(ring *Ring) {
+    int Slot = Ring->Index++;
+    if(Ring->Length < Ring->Capacity) {
+        ++Ring->Length;
+    }
+    if(Ring->Index >= Ring->Capacity) {
+        Ring->Index = 0;
+    }
+    return Slot;
+}
+
+void AddPipe(pipeStore *Pipes, float X, float Y) {
+    int Slot = AddToRing(&Pipes->Ring);
+    Pipes->X[Slot] = X;
+    Pipes->Y[Slot] = Y;
+    Pipes->PreviousX[Slot] = X;
+    Pipes->Hit[Slot] = 0;
+}
+
+void AddTrail(trailStore *Trail, int Tick, float X, float Y) {
+    int Slot = AddToRing(&Trail->Ring);
+    Trail->SpawnTick[Slot] = Tick;
+    Trail->X[Slot] = X;
+    Trail->Y[Slot] = Y;
+}
+
+// Bottom pipe, then the top pipe above the gap
+void SpawnPipePair(world *World) {
+    float Offset = (float)RandomBelow(&World->Random, 10) - 5;
+    AddPipe(&World->Pipes, PipeStartX, PipeStartY + Offset);
+    AddPipe(&World->Pipes, PipeStartX, PipeStartY + Offset + PipeHeight + PipeVerticalSpace);
+}
+
+// The same seed always gives the same pipes.
+
+void InitWorld(world *World, unsigned int Seed) {
+
+    World->Seed = Seed;
+    SeedRandom(&World->Random, Seed);
+
+    World->Bird = (bird){
+        .Position = {BirdStartX, BirdStartY, 0.0f},
+        .PreviousPosition = {BirdStartX, BirdStartY, 0.0f},
+        .Velocity = {0.0f, 0.0f, 0.0f},
+        .MaxVelocity = BirdMaxVelocity,
+    };
+
+    World->Pipes.Ring = (ring){.Capacity = MAX_PIPES_AMOUNT};
+    World->Trail.Ring = (ring){.Capacity = MAX_TRAIL_LENGTH};
+
+    World->Tick = 0;
+    World->PipeTicks = 0;
+    World->TrailTicks = 0;
+
+    World->Score = 0;
+
+    World->PracticeMode = 1;
+    World->Pause = 0;
+    World->Running = 1;
+}
+
+// Remember where everything was so the renderer can interpolate
+// between the previous and the current step. Only X changes for pipes,
+// trail pieces do not move at all.
+
+void SavePreviousPositions(world *World) {
+    World->Bird.PreviousPosition = World->Bird.Position;
+    memcpy(World->Pipes.PreviousX, World->Pipes.X, World->Pipes.Ring.Length * sizeof(float));
+}
+
+// Advances the world by exactly one DeltaTime step.
+
+void UpdateWorld(world *World, input *Input) {
+
+    if(Input->TogglePause) {
+        World->Pause = !World->Pause;
+    }
+    if(Input->TogglePracticeMode) {
+        World->PracticeMode = !World->PracticeMode;
+    }
+
+    if(World->Pause) return;
+
+    ++World->Tick;
+
+    SavePreviousPositions(World);
+
+    bird *Bird = &World->Bird;
+    pipeStore *Pipes = &World->Pipes;
+    trailStore *Trail = &World->Trail;
+
+    // Bird
+
+    v3 Acceleration = {0.0f, -Gravity, 0.0f};
+
+    if(Input->Flap) {
+        Acceleration.Y = 4 * Gravity;
+    }
+
+    // velocity += acceleration * dt * speed
+
+    Bird->Velocity = AddV3(Bird->Velocity,
+                           MultiplyV3Scalar(Acceleration, DeltaTime * BirdSpeed));
+
+    if(Bird->Velocity.Y >= Bird->MaxVelocity) {
+        Bird->Velocity.Y = Bird->MaxVelocity;
+    }
+
+    // position += velocity * dt * speed
+
+    Bird->Position = AddV3(Bird->Position, MultiplyV3Scalar(Bird->Velocity, DeltaTime * BirdSpeed));
+
+    // Pipes: check collision with the bird, then move them
+
+    collisionBox Box = {
+        Bird->Position.X - BirdWidth / 2.0f,
+        Bird->Position.X + BirdWidth / 2.0f,
+        Bird->Position.Y + BirdHeight / 2.0f,
+        Bird->Position.Y - BirdHeight / 2.0f,
+        PipeWidth / 2.0f,
+        PipeHeight / 2.0f,
+    };
+
+    uint32_t Hits = Kernels.PipesHit(Pipes->X, Pipes->Y, Pipes->Ring.Length, &Box);
+
+    if(Hits) {
+        if(World->PracticeMode) {
+            for(int Index = 0; Index < Pipes->Ring.Length; ++Index) {
+                Pipes->Hit[Index] |= (Hits >> Index) & 1;
+            }
+        } else {
+            World->Running = 0;
+        }
+    }
+
+    // Count a point when the bottom pipe of a pair passes the bird.
+    // Pairs are added back to back so bottom pipes always sit at even
+    // indices.
+
+    uint32_t Crossed = Kernels.MovePipes(Pipes->X, Pipes->Ring.Length,
+                                         DeltaTime * PipeSpeed, Bird->Position.X);
+    World->Score += CountBits(Crossed & 0x55555555);
+
+    // Add trail entry
+
+    if(++World->TrailTicks >= TrailSpawnTicks) {
+        AddTrail(Trail, World->Tick, Bird->Position.X, Bird->Position.Y);
+        World->TrailTicks = 0;
+    }
+
+    // Spawn new pipe pair
+
+    if(++World->PipeTicks >= PipeSpawnTicks) {
+        SpawnPipePair(World);
+        World->PipeTicks = 0;
+    }
+
+}
+
+#endif
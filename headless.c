@@ -0,0 +1,1830 @@
+#define _POSIX_C_SOURCE 199309L
+#include <stdio.h>
+#include <time.h>
+
+#include "game.h"
+#include "batch.h"
+#include "jobs.h"
+#include "render.h"
+#include "raster.h"
+#include "replay.h"
+#include "profile.h"
+#include "clock.h"
+#include "events.h"
+#include "pacing.h"
+#include "env.h"
+#include "autopilot.h"
+#include "snapshot.h"
+#include "sweep.h"
+#include "pipeline.h"
+#include "capture.h"
+
+// Headless runner: steps the simulation as fast as the CPU allows
+// without a window or a renderer.
+//
+// usage: headless [-steps N] [-seed N] [-batch WORLDS] [-threads N]
+//                 [-scaling MAXTHREADS] [-kernels ROUNDS] [-frames 1]
+//                 [-render OUT.png|OUT.ppm] [-golden EXPECTED.ppm]
+//                 [-record OUT.replay] [-replay IN.replay] [-random COUNT]
+//                 [-profile OUT.json] [-drift HOURS] [-latency SECONDS]
+//                 [-pacing SECONDS] [-env STEPS] [-autopilot STEPS]
+//                 [-horizon TICKS] [-states N] [-snapshot STEPS]
+//                 [-save OUT.snap] [-coarse TICKS] [-pipeline SECONDS]
+//                 [-capture OUT.y4m|OUT.rgba] [-seconds N] [-queue FRAMES]
+
+world World;
+unsigned int Seed = 1;
+
+// Flap whenever the bird sinks below the middle of the pipe gap
+float HoverY = 27.5f;
+
+int BatchChunkSize = 256;
+
+double GetSeconds() {
+    return NanosecondsToSeconds(GetMonotonicNanoseconds());
+}
+
+// With a RecordPath every step also goes into a replay that is written
+// there at the end.
+
+void RunWorld(long Steps, char *RecordPath) {
+
+    InitWorld(&World, Seed);
+
+    replay Replay;
+    InitReplay(&Replay, Seed);
+
+    input Input = {0};
+
+    double Start = GetSeconds();
+
+    for(long Step = 0; Step < Steps && World.Running; ++Step) {
+        Input.Flap = (World.Bird.Position.Y < HoverY);
+        UpdateWorld(&World, &Input);
+        if(RecordPath) {
+            RecordStep(&Replay, &Input, &World);
+        }
+    }
+
+    double Elapsed = GetSeconds() - Start;
+
+    if(RecordPath) {
+        if(!WriteReplay(&Replay, RecordPath)) {
+            fprintf(stderr, "could not write %s\n", RecordPath);
+        }
+        printf("recorded:     %u steps in %u runs\n", Replay.StepCount, Replay.RunCount);
+        FreeReplay(&Replay);
+    }
+
+    printf("steps:        %ld\n", Steps);
+    printf("seconds:      %f\n", Elapsed);
+    printf("steps/second: %.0f\n", Steps / Elapsed);
+    printf("real time:    %.0fx\n", Steps * DeltaTime / Elapsed);
+    printf("pipes:        %d\n", World.Pipes.Ring.Length);
+    printf("score:        %d\n", World.Score);
+    printf("bird:         %f %f\n", World.Bird.Position.X, World.Bird.Position.Y);
+    printf("world size:   %zu bytes\n", sizeof(World));
+}
+
+typedef struct {
+    worldBatch *Batch;
+    unsigned char *Actions;
+} batchJob;
+
+void StepBatchJob(void *Data, int First, int Last) {
+    batchJob *Job = Data;
+    worldBatch *Batch = Job->Batch;
+
+    for(int Index = First; Index < Last; ++Index) {
+        Job->Actions[Index] = (Batch->BirdY[Index] < HoverY);
+    }
+
+    StepBatchRange(Batch, Job->Actions, First, Last);
+}
+
+// Returns world steps per second
+
+double RunBatch(long Steps, int Count, int Threads, int Quiet) {
+
+    worldBatch Batch;
+    if(!CreateBatch(&Batch, Count, Seed)) {
+        fprintf(stderr, "CreateBatch failed\n");
+        return 0.0;
+    }
+    Batch.AutoReset = 1;
+
+    jobPool Pool;
+    Threads = CreateJobPool(&Pool, Threads);
+
+    batchJob Job = {
+        .Batch = &Batch,
+        .Actions = calloc(Count, 1),
+    };
+
+    double Start = GetSeconds();
+
+    for(long Step = 0; Step < Steps; ++Step) {
+        RunJob(&Pool, StepBatchJob, &Job, Count, BatchChunkSize);
+    }
+
+    double Elapsed = GetSeconds() - Start;
+    double WorldSteps = (double)Steps * Count;
+
+    long Games = 0;
+    long Steals = 0;
+    for(int Index = 0; Index < Count; ++Index) {
+        Games += Batch.Episodes[Index];
+    }
+    for(int Index = 0; Index < Threads; ++Index) {
+        Steals += Pool.Workers[Index].Steals;
+    }
+
+    if(!Quiet) {
+        printf("worlds:             %d\n", Count);
+        printf("threads:            %d\n", Threads);
+        printf("steps:              %ld\n", Steps);
+        printf("seconds:            %f\n", Elapsed);
+        printf("world steps/second: %.0f\n", WorldSteps / Elapsed);
+        printf("games finished:     %ld\n", Games);
+        printf("steals:             %ld\n", Steals);
+    }
+
+    DestroyJobPool(&Pool);
+    free(Job.Actions);
+    FreeBatch(&Batch);
+
+    return WorldSteps / Elapsed;
+}
+
+// Same batch on 1, 2, 4 ... MaxThreads threads
+
+void RunScaling(long Steps, int Count, int MaxThreads) {
+
+    double Base = 0.0;
+
+    printf("threads  world steps/second  speedup  efficiency\n");
+
+    for(int Threads = 1; Threads <= MaxThreads; Threads *= 2) {
+        double Rate = RunBatch(Steps, Count, Threads, 1);
+        if(Threads == 1) Base = Rate;
+        printf("%7d  %18.0f  %7.2f  %9.0f%%\n",
+               Threads, Rate, Rate / Base, 100.0 * Rate / Base / Threads);
+    }
+}
+
+// Collision and movement over the pipes of Count worlds, once through
+// RectanglesIntersect() like UpdateWorld() and once per kernel set.
+
+uint32_t KernelSink;
+
+double TimeRectangles(float *X, float *Y, int Count, int Stride, int Pipes, long Rounds) {
+    double Start = GetSeconds();
+    for(long Round = 0; Round < Rounds; ++Round) {
+        for(int World = 0; World < Count; ++World) {
+            float *PipeX = X + World * Stride;
+            float *PipeY = Y + World * Stride;
+            rectangle BirdRectangle = {19.5f, 20.5f, 28.0f, 27.0f};
+            for(int Index = 0; Index < Pipes; ++Index) {
+                rectangle PipeRectangle = {
+                    PipeX[Index] - PipeWidth / 2.0f,
+                    PipeX[Index] + PipeWidth / 2.0f,
+                    PipeY[Index] + PipeHeight / 2.0f,
+                    PipeY[Index] - PipeHeight / 2.0f,
+                };
+                KernelSink += RectanglesIntersect(&BirdRectangle, &PipeRectangle);
+                PipeX[Index] -= DeltaTime * PipeSpeed;
+            }
+        }
+    }
+    return GetSeconds() - Start;
+}
+
+double TimeKernels(kernels *Set, float *X, float *Y, int Count, int Stride, int Pipes, long Rounds) {
+    collisionBox Box = {19.5f, 20.5f, 28.0f, 27.0f, PipeWidth / 2.0f, PipeHeight / 2.0f};
+    double Start = GetSeconds();
+    for(long Round = 0; Round < Rounds; ++Round) {
+        for(int World = 0; World < Count; ++World) {
+            float *PipeX = X + World * Stride;
+            float *PipeY = Y + World * Stride;
+            KernelSink += Set->PipesHit(PipeX, PipeY, Pipes, &Box);
+            KernelSink += Set->MovePipes(PipeX, Pipes, DeltaTime * PipeSpeed, BirdStartX);
+        }
+    }
+    return GetSeconds() - Start;
+}
+
+// Same pipes for every path so none of them gets easier data
+
+void FillPipes(float *X, float *Y, int Count) {
+    random Random;
+    SeedRandom(&Random, 1);
+    for(int Index = 0; Index < Count; ++Index) {
+        X[Index] = (float)RandomBelow(&Random, 50);
+        Y[Index] = (float)RandomBelow(&Random, 60);
+    }
+}
+
+void RunKernels(long Rounds) {
+
+    int Count = 4096;
+    int Stride = BATCH_PIPE_STRIDE;
+    float *X = malloc(Count * Stride * sizeof(float));
+    float *Y = malloc(Count * Stride * sizeof(float));
+
+    kernels *Sets[3];
+    int SetCount = 0;
+    Sets[SetCount++] = &KernelsScalar;
+#ifdef KERNELS_X86
+    Sets[SetCount++] = &KernelsSSE;
+    if(CpuHasAVX2()) Sets[SetCount++] = &KernelsAVX2;
+#endif
+
+    printf("selected: %s\n", Kernels.Name);
+    printf("%-14s %-12s %12s\n", "layout", "path", "ns/world");
+
+    // Single world layout has MAX_PIPES_AMOUNT pipes, the batch layout
+    // runs over the padded stride
+
+    int Layouts[2] = {MAX_PIPES_AMOUNT, BATCH_PIPE_STRIDE};
+    char *LayoutNames[2] = {"single world", "batch"};
+
+    for(int Layout = 0; Layout < 2; ++Layout) {
+        int Pipes = Layouts[Layout];
+
+        FillPipes(X, Y, Count * Stride);
+        double Seconds = TimeRectangles(X, Y, Count, Stride, Pipes, Rounds);
+        printf("%-14s %-12s %12.2f\n", LayoutNames[Layout], "rectangles",
+               Seconds * 1e9 / ((double)Count * Rounds));
+
+        for(int Set = 0; Set < SetCount; ++Set) {
+            FillPipes(X, Y, Count * Stride);
+            Seconds = TimeKernels(Sets[Set], X, Y, Count, Stride, Pipes, Rounds);
+            printf("%-14s %-12s %12.2f\n", LayoutNames[Layout], Sets[Set]->Name,
+                   Seconds * 1e9 / ((double)Count * Rounds));
+        }
+    }
+
+    free(X);
+    free(Y);
+}
+
+// Pipe offsets from rand() against the world's own generator. The first
+// numbers of seed 1 are printed to compare across platforms.
+
+void RunRandom(long Count) {
+
+    srand(Seed);
+    double Start = GetSeconds();
+    for(long Index = 0; Index < Count; ++Index) {
+        KernelSink += rand() % 10;
+    }
+    double Rand = GetSeconds() - Start;
+
+    random Random;
+    SeedRandom(&Random, Seed);
+    Start = GetSeconds();
+    for(long Index = 0; Index < Count; ++Index) {
+        KernelSink += RandomBelow(&Random, 10);
+    }
+    double Xoshiro = GetSeconds() - Start;
+
+    Start = GetSeconds();
+    for(long Index = 0; Index < Count / 1000; ++Index) {
+        SplitRandom(&Random);
+    }
+    double Split = GetSeconds() - Start;
+
+    SeedRandom(&Random, 1);
+    printf("seed 1:           %08x %08x %08x %08x\n", NextRandom(&Random), NextRandom(&Random),
+           NextRandom(&Random), NextRandom(&Random));
+    printf("ns/number rand:   %.2f\n", Rand * 1e9 / Count);
+    printf("ns/number random: %.2f\n", Xoshiro * 1e9 / Count);
+    printf("ns/split:         %.2f\n", Split * 1e9 / (Count / 1000));
+    printf("sink:             %u\n", KernelSink);
+}
+
+// Records the command list for every step like Draw() does, without a
+// GPU. Shows how many draws a frame turns into.
+
+commandList Commands;
+
+void RunFrames(long Steps) {
+
+    InitMeshData();
+    InitWorld(&World, Seed);
+
+    int XTiles = 60;
+    int YTiles = 60;
+    random TileRandom = World.Random;
+    JumpRandom(&TileRandom);
+    color *Background = malloc(XTiles * YTiles * sizeof(color));
+    FillBackground(Background, XTiles, YTiles, &TileRandom);
+
+    backgroundMesh BackgroundMesh = {0};
+    if(BakeBackground(&BackgroundMesh, Background, XTiles, YTiles, 0) < 0) {
+        fprintf(stderr, "out of memory\n");
+        free(Background);
+        return;
+    }
+
+    // Same camera the game starts with
+
+    v3 CameraPosition = {25.0f, 30.0f, -35.0f};
+    matrix View = GetViewMatrix(CameraPosition);
+    matrix Projection = GetProjectionMatrix(384.0f / 561.0f, 1.0f, 1.0f, 100.0f);
+    matrix ViewProjection = MultiplyMatrix(&View, &Projection);
+    bounds Visible = GetVisibleBounds(&ViewProjection, 0.0f);
+
+    input Input = {0};
+    double Tiles = 0.0;
+    double Baked = 0.0;
+    int TileInstances = 0;
+
+    for(long Step = 0; Step < Steps; ++Step) {
+        Input.Flap = (World.Bird.Position.Y < HoverY);
+        UpdateWorld(&World, &Input);
+
+        // Background as one instance per tile
+
+        double Start = GetSeconds();
+        ResetCommands(&Commands);
+        PushBackground(&Commands, Background, XTiles, YTiles);
+        Tiles += GetSeconds() - Start;
+        TileInstances = Commands.InstanceCount;
+
+        // Background baked once, then only the visible chunks
+
+        Start = GetSeconds();
+        ResetCommands(&Commands);
+        BakeBackground(&BackgroundMesh, Background, XTiles, YTiles, 0);
+        PushBakedBackground(&Commands, &BackgroundMesh, &Visible);
+        Baked += GetSeconds() - Start;
+
+        PushWorld(&Commands, &World, 1.0f, &Visible);
+    }
+
+    printf("frames:              %ld\n", Steps);
+    printf("instances/frame:     %d\n", Commands.InstanceCount);
+    printf("draws/frame:         %d\n", Commands.BatchCount);
+    printf("dropped:             %d\n", Commands.Dropped);
+    printf("submitted/culled:    %d/%d\n", Commands.Submitted, Commands.Culled);
+    printf("visible:             x %.1f..%.1f y %.1f..%.1f\n",
+           Visible.MinX, Visible.MaxX, Visible.MinY, Visible.MaxY);
+    printf("background instances tiled/baked: %d/1\n", TileInstances);
+    printf("background us/frame tiled/baked:  %.3f/%.3f\n",
+           Tiles * 1e6 / Steps, Baked * 1e6 / Steps);
+
+    FreeBackgroundMesh(&BackgroundMesh);
+    free(Background);
+}
+
+// Steps the world, then draws the last frame with the software
+// rasterizer. With a golden image the frame is compared against it and
+// the exit code says whether they match.
+
+int RunRender(long Steps, int Threads, char *OutputPath, char *GoldenPath) {
+
+    InitMeshData();
+    InitWorld(&World, Seed);
+
+    int XTiles = 60;
+    int YTiles = 60;
+    random TileRandom = World.Random;
+    JumpRandom(&TileRandom);
+    color *Background = malloc(XTiles * YTiles * sizeof(color));
+    FillBackground(Background, XTiles, YTiles, &TileRandom);
+
+    input Input = {0};
+    for(long Step = 0; Step < Steps; ++Step) {
+        Input.Flap = (World.Bird.Position.Y < HoverY);
+        UpdateWorld(&World, &Input);
+    }
+
+    backgroundMesh BackgroundMesh = {0};
+    if(BakeBackground(&BackgroundMesh, Background, XTiles, YTiles, 0) < 0) {
+        fprintf(stderr, "out of memory\n");
+        free(Background);
+        return 1;
+    }
+
+    v3 CameraPosition = {25.0f, 30.0f, -35.0f};
+    matrix View = GetViewMatrix(CameraPosition);
+    matrix Projection = GetProjectionMatrix(384.0f / 561.0f, 1.0f, 1.0f, 100.0f);
+    ResetCommands(&Commands);
+    Commands.ViewProjection = MultiplyMatrix(&View, &Projection);
+    bounds Visible = GetVisibleBounds(&Commands.ViewProjection, 0.0f);
+    PushBakedBackground(&Commands, &BackgroundMesh, &Visible);
+    PushWorld(&Commands, &World, 1.0f, &Visible);
+
+    jobPool Pool;
+    Threads = CreateJobPool(&Pool, Threads);
+
+    rasterizer Rasterizer;
+    if(!CreateRasterizer(&Rasterizer, 384, 561, &Pool)) {
+        fprintf(stderr, "CreateRasterizer failed\n");
+        DestroyJobPool(&Pool);
+        FreeBackgroundMesh(&BackgroundMesh);
+        free(Background);
+        return 1;
+    }
+
+    int Rounds = 100;
+    double Start = GetSeconds();
+    for(int Round = 0; Round < Rounds; ++Round) {
+        RasterizeCommands(&Rasterizer, &Commands, &BackgroundMesh);
+    }
+    double Seconds = GetSeconds() - Start;
+
+    printf("size:                %dx%d\n", Rasterizer.Target.Width, Rasterizer.Target.Height);
+    printf("threads:             %d\n", Threads);
+    printf("draws/triangles:     %d/%d\n", Commands.BatchCount, Rasterizer.TriangleCount);
+    printf("ms/frame:            %.3f\n", Seconds * 1e3 / Rounds);
+
+    int Result = 0;
+
+    if(OutputPath) {
+        size_t Length = strlen(OutputPath);
+        int Written = (Length > 4 && !strcmp(OutputPath + Length - 4, ".png")) ?
+                      WritePNG(&Rasterizer.Target, OutputPath) :
+                      WritePPM(&Rasterizer.Target, OutputPath);
+        if(!Written) {
+            fprintf(stderr, "could not write %s\n", OutputPath);
+            Result = 1;
+        }
+    }
+
+    if(GoldenPath) {
+        framebuffer Golden;
+        if(!ReadPPM(&Golden, GoldenPath)) {
+            fprintf(stderr, "could not read %s\n", GoldenPath);
+            Result = 1;
+        } else {
+            long Different = CompareFramebuffers(&Rasterizer.Target, &Golden, 0);
+            if(Different < 0) {
+                printf("golden:              size mismatch\n");
+                Result = 1;
+            } else {
+                printf("golden:              %ld pixels differ\n", Different);
+                Result = Different != 0;
+            }
+            FreeFramebuffer(&Golden);
+        }
+    }
+
+    FreeRasterizer(&Rasterizer);
+    DestroyJobPool(&Pool);
+    FreeBackgroundMesh(&BackgroundMesh);
+    free(Background);
+    return Result;
+}
+
+// Writes broken copies of the replay at Path next to it and returns how
+// many of them ReadReplay() turned down, which should be all of them:
+// a huge run count, a huge step count and a missing last byte.
+
+int CountRejectedReplays(char *Path, int *Variants) {
+
+    *Variants = 3;
+
+    FILE *File = fopen(Path, "rb");
+    if(!File) return 0;
+    fseek(File, 0, SEEK_END);
+    long Size = ftell(File);
+    fseek(File, 0, SEEK_SET);
+    uint8_t *Data = Size >= 20 ? malloc(Size) : 0;
+    int Read = Data && fread(Data, 1, Size, File) == (size_t)Size;
+    fclose(File);
+    if(!Read) {
+        free(Data);
+        return 0;
+    }
+
+    char BadPath[1024];
+    snprintf(BadPath, sizeof(BadPath), "%s.malformed", Path);
+
+    int Rejected = 0;
+    for(int Variant = 0; Variant < *Variants; ++Variant) {
+        uint8_t Header[20];
+        memcpy(Header, Data, 20);
+        long Length = Size;
+        if(Variant == 0) memset(Header + 16, 0xFF, 4); // RunCount
+        if(Variant == 1) memset(Header + 12, 0xFF, 4); // StepCount
+        if(Variant == 2) --Length;
+
+        File = fopen(BadPath, "wb");
+        if(!File) continue;
+        fwrite(Header, 1, 20, File);
+        fwrite(Data + 20, 1, Length - 20, File);
+        fclose(File);
+
+        replay Bad;
+        if(ReadReplay(&Bad, BadPath)) {
+            FreeReplay(&Bad);
+        } else {
+            ++Rejected;
+        }
+    }
+
+    remove(BadPath);
+    free(Data);
+    return Rejected;
+}
+
+// Plays a replay back as fast as possible and checks the world hash
+// after every step. Returns 1 at the first step that differs.
+
+int RunReplay(char *Path) {
+
+    replay Replay;
+    if(!ReadReplay(&Replay, Path)) {
+        fprintf(stderr, "could not read %s\n", Path);
+        return 1;
+    }
+
+    InitWorld(&World, Replay.Seed);
+
+    replayCursor Cursor = {0};
+    input Input;
+    int Result = 0;
+
+    double Start = GetSeconds();
+
+    while(NextReplayInput(&Replay, &Cursor, &Input)) {
+        UpdateWorld(&World, &Input);
+
+        uint32_t Hash = HashWorld(&World);
+        uint32_t Expected = Replay.Hashes[Cursor.Step - 1];
+        if(Hash != Expected) {
+            printf("diverged:     step %u (tick %d) hash %08x expected %08x\n",
+                   Cursor.Step - 1, World.Tick, Hash, Expected);
+            Result = 1;
+            break;
+        }
+    }
+
+    double Elapsed = GetSeconds() - Start;
+
+    printf("seed:         %u\n", Replay.Seed);
+    printf("steps:        %u/%u\n", Cursor.Step, Replay.StepCount);
+    printf("input runs:   %u\n", Replay.RunCount);
+    printf("steps/second: %.0f\n", Cursor.Step / Elapsed);
+    printf("score:        %d\n", World.Score);
+    if(!Result) {
+        printf("verified:     all steps match\n");
+    }
+
+    int Variants;
+    int Rejected = CountRejectedReplays(Path, &Variants);
+    printf("malformed:    %d/%d broken copies rejected\n", Rejected, Variants);
+    if(Rejected != Variants) Result = 1;
+
+    FreeReplay(&Replay);
+    return Result;
+}
+
+// Runs Steps whole frames, world step, command list and software
+// rasterization, with profiler zones around each phase. Writes a Chrome
+// trace to Path and prints the frame time histogram. Needs a build with
+// -DPROFILE.
+
+int RunProfile(long Steps, int Threads, char *Path) {
+
+#ifndef PROFILE
+    fprintf(stderr, "built without PROFILE, rebuild with ./build.sh -DPROFILE\n");
+    return 1;
+#endif
+
+    if(!InitProfiler(&Profiler)) {
+        fprintf(stderr, "InitProfiler failed\n");
+        return 1;
+    }
+
+    InitMeshData();
+    InitWorld(&World, Seed);
+
+    int XTiles = 60;
+    int YTiles = 60;
+    random TileRandom = World.Random;
+    JumpRandom(&TileRandom);
+    color *Background = malloc(XTiles * YTiles * sizeof(color));
+    FillBackground(Background, XTiles, YTiles, &TileRandom);
+
+    backgroundMesh BackgroundMesh = {0};
+    if(BakeBackground(&BackgroundMesh, Background, XTiles, YTiles, 0) < 0) {
+        fprintf(stderr, "out of memory\n");
+        FreeProfiler(&Profiler);
+        free(Background);
+        return 1;
+    }
+
+    jobPool Pool;
+    Threads = CreateJobPool(&Pool, Threads);
+
+    rasterizer Rasterizer;
+    if(!CreateRasterizer(&Rasterizer, 384, 561, &Pool)) {
+        fprintf(stderr, "CreateRasterizer failed\n");
+        DestroyJobPool(&Pool);
+        FreeProfiler(&Profiler);
+        FreeBackgroundMesh(&BackgroundMesh);
+        free(Background);
+        return 1;
+    }
+
+    v3 CameraPosition = {25.0f, 30.0f, -35.0f};
+    input Input = {0};
+
+    for(long Step = 0; Step < Steps; ++Step) {
+
+        PROFILE_BEGIN("UpdateWorld");
+        Input.Flap = (World.Bird.Position.Y < HoverY);
+        UpdateWorld(&World, &Input);
+        PROFILE_END();
+
+        PROFILE_BEGIN("Record");
+        ResetCommands(&Commands);
+        matrix View = GetViewMatrix(CameraPosition);
+        matrix Projection = GetProjectionMatrix(384.0f / 561.0f, 1.0f, 1.0f, 100.0f);
+        Commands.ViewProjection = MultiplyMatrix(&View, &Projection);
+        bounds Visible = GetVisibleBounds(&Commands.ViewProjection, 0.0f);
+        BakeBackground(&BackgroundMesh, Background, XTiles, YTiles, 0);
+        PushBakedBackground(&Commands, &BackgroundMesh, &Visible);
+        PushWorld(&Commands, &World, 1.0f, &Visible);
+        PushProfileOverlay(&Commands, &Profiler, &Visible);
+        PROFILE_END();
+
+        PROFILE_COUNT("draws", Commands.BatchCount);
+        PROFILE_COUNT("instances", Commands.InstanceCount);
+
+        PROFILE_BEGIN("Rasterize");
+        RasterizeCommands(&Rasterizer, &Commands, &BackgroundMesh);
+        PROFILE_END();
+
+        PROFILE_FRAME();
+    }
+
+    int Buckets[PROFILE_BUCKETS];
+    GetFrameHistogram(&Profiler, Buckets);
+
+    printf("frames:       %ld\n", Steps);
+    printf("threads:      %d\n", Threads);
+    printf("events:       %llu\n", (unsigned long long)Profiler.EventCount);
+    printf("last %d frames:\n", Profiler.FrameCount);
+    for(int Bucket = 0; Bucket < PROFILE_BUCKETS; ++Bucket) {
+        if(!Buckets[Bucket]) continue;
+        printf("  %5.1f ms %s %d\n", Bucket * ProfileBucketMilliSeconds,
+               Bucket == PROFILE_BUCKETS - 1 ? "+ " : "  ", Buckets[Bucket]);
+    }
+
+    int Result = 0;
+    if(!WriteProfileTrace(&Profiler, Path)) {
+        fprintf(stderr, "could not write %s\n", Path);
+        Result = 1;
+    }
+
+    FreeRasterizer(&Rasterizer);
+    DestroyJobPool(&Pool);
+    FreeProfiler(&Profiler);
+    FreeBackgroundMesh(&BackgroundMesh);
+    free(Background);
+    return Result;
+}
+
+// Long run drift check on a virtual clock. Feeds Hours of jittery frame
+// times into the fixed step loop twice: the old way, a 10 MHz
+// performance counter converted to whole microseconds and summed into a
+// float accumulator, and through a stepClock. After N seconds exactly
+// N * StepsPerSecond steps should have run. Returns 1 if the step clock
+// is off by even one step.
+
+int RunDrift(double Hours) {
+
+    uint64_t Duration = (uint64_t)(Hours * 3600.0) * NANOSECONDS_PER_SECOND;
+
+    gameClock Clock = CreateVirtualClock(0);
+    timer FrameTimer;
+    InitTimer(&FrameTimer, &Clock);
+
+    random Random;
+    SeedRandom(&Random, Seed);
+
+    // Old: QueryPerformanceCounter at 10 MHz through the old UpdateTimer()
+    int64_t CountsPerSecond = 10000000;
+    int64_t LastCount = 0;
+    float Accumulator = 0.0f;
+    uint64_t OldSteps = 0;
+
+    stepClock StepClock = CreateStepClock(StepsPerSecond);
+    uint64_t NewSteps = 0;
+
+    uint64_t Frames = 0;
+    while(ReadClock(&Clock) < Duration) {
+
+        // 8 to 33 ms, not a whole number of anything
+        uint64_t FrameTime = 8000000 + RandomBelow(&Random, 25000000);
+        if(ReadClock(&Clock) + FrameTime > Duration) {
+            FrameTime = Duration - ReadClock(&Clock);
+        }
+        AdvanceClock(&Clock, FrameTime);
+        ++Frames;
+
+        int64_t Count = (int64_t)(ReadClock(&Clock) / (NANOSECONDS_PER_SECOND / CountsPerSecond));
+        int64_t Total = (Count - LastCount) * 1000000;
+        double ElapsedMilliSeconds = (double)(Total / CountsPerSecond) / 1000;
+        LastCount = Count;
+
+        Accumulator += (float)(ElapsedMilliSeconds / 1000.0);
+        while(Accumulator >= DeltaTime) {
+            ++OldSteps;
+            Accumulator -= DeltaTime;
+        }
+
+        NewSteps += AdvanceSteps(&StepClock, LapTimer(&FrameTimer));
+    }
+
+    uint64_t Expected = Duration / NANOSECONDS_PER_SECOND * StepsPerSecond;
+    int64_t OldError = (int64_t)OldSteps - (int64_t)Expected;
+    int64_t NewError = (int64_t)NewSteps - (int64_t)Expected;
+
+    printf("virtual time:      %.2f h\n", NanosecondsToSeconds(Duration) / 3600.0);
+    printf("frames:            %llu\n", (unsigned long long)Frames);
+    printf("expected steps:    %llu\n", (unsigned long long)Expected);
+    printf("float accumulator: %llu (%+lld steps, %+.3f s)\n", (unsigned long long)OldSteps,
+           (long long)OldError, (double)OldError / StepsPerSecond);
+    printf("step clock:        %llu (%+lld steps)\n", (unsigned long long)NewSteps, (long long)NewError);
+
+    return NewError != 0;
+}
+
+// Input latency on a virtual clock. Frames are paced by a 60 Hz vsync
+// and messages are handled at the start of each frame, like in WinMain.
+// Taps of 5 to 150 ms arrive at random times. Once through the old
+// path, key state sampled once per frame, and once through the event
+// queue. Reports taps that never reached the simulation and the input
+// to simulation and input to present delays.
+
+void PrintLatency(char *Name, long Lost, long Taps, latencyStats *ToSimulation, latencyStats *ToPresent) {
+    printf("%-6s lost %ld/%ld taps\n", Name, Lost, Taps);
+    printf("       input to simulation: mean %6.2f ms p99 %5.1f ms max %6.2f ms\n",
+           GetLatencyMean(ToSimulation), GetLatencyPercentile(ToSimulation, 99.0), ToSimulation->Max / 1e6);
+    printf("       input to present:    mean %6.2f ms p99 %5.1f ms max %6.2f ms\n",
+           GetLatencyMean(ToPresent), GetLatencyPercentile(ToPresent, 99.0), ToPresent->Max / 1e6);
+}
+
+int RunLatency(double Seconds) {
+
+    uint64_t Duration = (uint64_t)(Seconds * 1e9);
+    uint64_t Refresh = NANOSECONDS_PER_SECOND / 60;
+
+    random Random;
+    SeedRandom(&Random, Seed);
+
+    // Press, release, press, release, ... never overlapping
+
+    int EventCapacity = (int)(Seconds * 20) + 16;
+    inputEvent *Events = malloc(EventCapacity * sizeof(inputEvent));
+    int EventCount = 0;
+    for(uint64_t Time = 0; EventCount + 2 <= EventCapacity; ) {
+        Time += 100000000 + RandomBelow(&Random, 500000000);
+        uint64_t Hold = 5000000 + RandomBelow(&Random, 145000000);
+        if(Time + Hold + 2 * Refresh >= Duration) break;
+        Events[EventCount++] = (inputEvent){Time, ACTION_FLAP, 1};
+        Events[EventCount++] = (inputEvent){Time + Hold, ACTION_FLAP, 0};
+        Time += Hold;
+    }
+    int TapCount = EventCount / 2;
+
+    // Old: the space key state read once per frame for all of its steps
+
+    latencyStats OldToSimulation = {0};
+    latencyStats OldToPresent = {0};
+    long OldSeen = 0;
+    {
+        stepClock StepClock = CreateStepClock(StepsPerSecond);
+        int Next = 0;
+        int KeyDown = 0;
+        int Tap = -1;
+        int Seen = 0;
+        for(uint64_t Frame = Refresh; Frame < Duration; Frame += Refresh) {
+            for(; Next < EventCount && Events[Next].Time <= Frame; ++Next) {
+                KeyDown = Events[Next].Down;
+                if(KeyDown) {
+                    Tap = Next / 2;
+                    Seen = 0;
+                }
+            }
+
+            if(AdvanceSteps(&StepClock, Refresh) && KeyDown && !Seen) {
+                AddLatency(&OldToSimulation, Frame - Events[Tap * 2].Time);
+                AddLatency(&OldToPresent, Frame + Refresh - Events[Tap * 2].Time);
+                Seen = 1;
+                ++OldSeen;
+            }
+        }
+    }
+
+    // New: timestamped events consumed per step, the last step of a
+    // frame takes everything handled so far. The queue has cache line
+    // aligned indices, static like InputQueue in engine.h.
+
+    static inputQueue LatencyQueue;
+    inputQueue *Queue = &LatencyQueue;
+    {
+        stepClock StepClock = CreateStepClock(StepsPerSecond);
+        int Next = 0;
+        for(uint64_t Frame = Refresh; Frame < Duration; Frame += Refresh) {
+            for(; Next < EventCount && Events[Next].Time <= Frame; ++Next) {
+                PushInputEvent(Queue, Events[Next].Action, Events[Next].Down, Events[Next].Time);
+            }
+
+            uint64_t FirstStep = StepClock.Steps + 1;
+            uint64_t Steps = AdvanceSteps(&StepClock, Refresh);
+            for(uint64_t Step = FirstStep; Step < FirstStep + Steps; ++Step) {
+                uint64_t StepTime = Step + 1 < FirstStep + Steps ?
+                                    GetStepRealTime(&StepClock, Step, Frame) : Frame;
+                ConsumeInput(Queue, StepTime);
+                MarkSimulated(Queue, Frame);
+            }
+            MarkPresented(Queue, Frame + Refresh);
+        }
+    }
+
+    printf("virtual time: %.1f s, 60 Hz, %d taps\n", Seconds, TapCount);
+    PrintLatency("old", TapCount - OldSeen, TapCount, &OldToSimulation, &OldToPresent);
+    PrintLatency("queue", TapCount - Queue->ToSimulation.Count, TapCount, &Queue->ToSimulation, &Queue->ToPresent);
+
+    free(Events);
+    return 0;
+}
+
+// Frame pacing on a virtual clock. A 60 Hz display shows a frame at
+// the first vertical blank after it was presented with vsync. Without
+// vsync it shows the frame at once and tears. As with a frame latency
+// waitable swap chain, a vsync frame does not start before the previous
+// one is on screen. Frames take 3 to 7 ms, with 20 ms spikes now and
+// then. Sleeping oversleeps by up to 1 ms, like a Windows timer.
+//
+// Reports per mode the frame rate, the time from the start of a frame
+// (where input is read) to the display, and the vertical blanks that
+// showed no new frame. Returns 1 if the median frame interval of target
+// FPS mode is not within half a millisecond above the target, or if just
+// in time mode is not faster than vsync.
+
+typedef struct {
+    gameClock *Clock;
+    random *Random;
+    long Spins;
+} virtualPlatform;
+
+void VirtualSleep(void *Context, uint64_t Nanoseconds) {
+    virtualPlatform *Platform = Context;
+    AdvanceClock(Platform->Clock, Nanoseconds + RandomBelow(Platform->Random, 1000000));
+}
+
+void VirtualSpin(void *Context) {
+    virtualPlatform *Platform = Context;
+    AdvanceClock(Platform->Clock, 1000);
+    ++Platform->Spins;
+}
+
+int RunPacing(double Seconds) {
+
+    uint64_t Duration = (uint64_t)(Seconds * 1e9);
+    uint64_t Refresh = NANOSECONDS_PER_SECOND / 60;
+    uint64_t Target = NANOSECONDS_PER_SECOND / 100;
+
+    printf("virtual time: %.1f s, 60 Hz display, target %d fps\n", Seconds,
+           (int)(NANOSECONDS_PER_SECOND / Target));
+
+    double Medians[PACING_MODE_COUNT];
+    double Latencies[PACING_MODE_COUNT];
+
+    for(int Mode = 0; Mode < PACING_MODE_COUNT; ++Mode) {
+
+        gameClock Clock = CreateVirtualClock(0);
+        random Random;
+        SeedRandom(&Random, Seed);
+
+        virtualPlatform Platform = {&Clock, &Random};
+        pacer Pacer;
+        InitPacer(&Pacer, Mode, &Clock, (pacingPlatform){VirtualSleep, VirtualSpin, &Platform}, Refresh);
+        Pacer.TargetInterval = Target;
+
+        latencyStats Latency = {0};
+        latencyStats Interval = {0};
+        uint64_t LastShown = 0;
+        uint64_t LastStart = 0;
+        long Missed = 0;
+
+        while(ReadClock(&Clock) < Duration) {
+
+            int Sync = GetPresentInterval(&Pacer);
+            if(Sync && LastShown) {
+                if(ReadClock(&Clock) < LastShown) {
+                    AdvanceClock(&Clock, LastShown - ReadClock(&Clock));
+                }
+                MarkVBlank(&Pacer, LastShown);
+            }
+
+            BeginFrame(&Pacer);
+            uint64_t Start = ReadClock(&Clock);
+            if(LastStart) AddLatency(&Interval, Start - LastStart);
+            LastStart = Start;
+
+            uint64_t Work = 3000000 + RandomBelow(&Random, 4000000);
+            if(RandomBelow(&Random, 100) < 2) Work = 20000000;
+            AdvanceClock(&Clock, Work);
+
+            EndFrameWork(&Pacer);
+            uint64_t Presented = ReadClock(&Clock);
+
+            uint64_t Shown = Presented;
+            if(Sync) {
+                Shown = (Presented + Refresh - 1) / Refresh * Refresh;
+                if(LastShown) Missed += (long)((Shown - LastShown) / Refresh) - 1;
+                LastShown = Shown;
+            }
+            AddLatency(&Latency, Shown - Start);
+        }
+
+        Medians[Mode] = GetLatencyPercentile(&Interval, 50.0);
+        Latencies[Mode] = GetLatencyMean(&Latency);
+
+        printf("%-13s %6.1f fps  interval p50 %5.1f p99 %5.1f ms  start to display mean %6.2f p99 %5.1f ms",
+               PacingModeNames[Mode], Pacer.Frames / Seconds, Medians[Mode],
+               GetLatencyPercentile(&Interval, 99.0), Latencies[Mode], GetLatencyPercentile(&Latency, 99.0));
+        if(GetPresentInterval(&Pacer)) {
+            printf("  missed %ld vblanks", Missed);
+        }
+        printf("\n              slept %.1f%%, spun %.1f%% of the time\n",
+               100.0 * Pacer.Slept / Duration, 100.0 * Pacer.Spun / Duration);
+    }
+
+    double TargetMilliSeconds = Target / 1e6;
+    int Failed = 0;
+    if(Medians[PACING_TARGET_FPS] <= TargetMilliSeconds || Medians[PACING_TARGET_FPS] > TargetMilliSeconds + 0.5) {
+        printf("target fps mode frames are %.1f ms apart instead of %.1f\n",
+               Medians[PACING_TARGET_FPS], TargetMilliSeconds);
+        Failed = 1;
+    }
+    if(Latencies[PACING_JUST_IN_TIME] >= Latencies[PACING_VSYNC]) {
+        printf("just in time mode is not faster than vsync\n");
+        Failed = 1;
+    }
+    return Failed;
+}
+
+// The serial frame loop against simulation and render threads, each for
+// Seconds on the real clock. The software rasterizer stands in for the
+// GPU and the autopilot plays, so both sides have real work. A third
+// thread taps the flap key at random, pushing events the way the
+// window procedure does. Frames are not paced.
+//
+// Reports per loop the frame rate, frame times and input latency, and
+// for the pipeline how many published frames were never drawn. Returns
+// 1 if a tap got lost or the pipeline drew frames out of order.
+
+typedef struct {
+    inputQueue *Queue;
+    uint64_t End;
+    unsigned int Seed;
+    long Taps;
+} tapper;
+
+void SleepNanoseconds(uint64_t Nanoseconds) {
+    struct timespec Time = {
+        (time_t)(Nanoseconds / NANOSECONDS_PER_SECOND),
+        (long)(Nanoseconds % NANOSECONDS_PER_SECOND),
+    };
+    nanosleep(&Time, 0);
+}
+
+void *TapThread(void *Data) {
+    tapper *Tapper = Data;
+    random Random;
+    SeedRandom(&Random, Tapper->Seed);
+    for(;;) {
+        SleepNanoseconds(100000000 + RandomBelow(&Random, 500000000));
+        uint64_t Hold = 5000000 + RandomBelow(&Random, 145000000);
+        if(GetMonotonicNanoseconds() + Hold + 100000000 >= Tapper->End) break;
+        PushInputEvent(Tapper->Queue, ACTION_FLAP, 1, GetMonotonicNanoseconds());
+        ++Tapper->Taps;
+        SleepNanoseconds(Hold);
+        PushInputEvent(Tapper->Queue, ACTION_FLAP, 0, GetMonotonicNanoseconds());
+    }
+    return 0;
+}
+
+typedef struct {
+    world World;
+    autopilot Pilot;
+    stepClock Clock;
+    uint64_t Last;
+    inputQueue *Queue;
+} pipelineSimulation;
+
+// Runs the steps due by Now like main.c's Update() does
+uint64_t RunDueSteps(pipelineSimulation *Sim, uint64_t Now) {
+    uint64_t FirstStep = Sim->Clock.Steps + 1;
+    uint64_t Steps = AdvanceSteps(&Sim->Clock, Now - Sim->Last);
+    Sim->Last = Now;
+
+    for(uint64_t Step = FirstStep; Step < FirstStep + Steps; ++Step) {
+        uint64_t StepTime = Step + 1 < FirstStep + Steps ? GetStepRealTime(&Sim->Clock, Step, Now) : Now;
+        input Input = ConsumeInput(Sim->Queue, StepTime);
+        Input.Flap |= RunAutopilot(&Sim->Pilot, &Sim->World);
+        UpdateWorld(&Sim->World, &Input);
+        MarkSimulated(Sim->Queue, GetMonotonicNanoseconds());
+    }
+    return Steps;
+}
+
+typedef struct {
+    pipelineSimulation Sim;
+    tripleBuffer Frames;
+    _Atomic int Quit;
+} pipelineRun;
+
+void *SimulationThread(void *Data) {
+    pipelineRun *Run = Data;
+    pipelineSimulation *Sim = &Run->Sim;
+
+    while(!atomic_load(&Run->Quit)) {
+        uint64_t Now = GetMonotonicNanoseconds();
+        if(RunDueSteps(Sim, Now)) {
+            frameState *Frame = GetBackFrame(&Run->Frames);
+            Frame->World = Sim->World;
+            Frame->Step = Sim->Queue->Steps;
+            Frame->StepTime = GetStepRealTime(&Sim->Clock, Sim->Clock.Steps, Now);
+            PublishFrame(&Run->Frames);
+        }
+
+        uint64_t Next = GetStepRealTime(&Sim->Clock, Sim->Clock.Steps + 1, Now);
+        Now = GetMonotonicNanoseconds();
+        if(Next > Now) SleepNanoseconds(Next - Now);
+    }
+    return 0;
+}
+
+typedef struct {
+    color *Background;
+    backgroundMesh BackgroundMesh;
+    rasterizer Rasterizer;
+    matrix ViewProjection;
+    bounds Visible;
+} pipelineRenderer;
+
+void DrawPipelineFrame(pipelineRenderer *Renderer, world *Frame, float Alpha) {
+    ResetCommands(&Commands);
+    Commands.ViewProjection = Renderer->ViewProjection;
+    PushBakedBackground(&Commands, &Renderer->BackgroundMesh, &Renderer->Visible);
+    PushWorld(&Commands, Frame, Alpha, &Renderer->Visible);
+    RasterizeCommands(&Renderer->Rasterizer, &Commands, &Renderer->BackgroundMesh);
+}
+
+// Also takes a renderer that was only partly set up
+void FreePipelineRenderer(pipelineRenderer *Renderer) {
+    FreeRasterizer(&Renderer->Rasterizer);
+    FreeBackgroundMesh(&Renderer->BackgroundMesh);
+    free(Renderer->Background);
+    Renderer->Background = 0;
+}
+
+int RunPipeline(double Seconds, int Threads, int Horizon, int MaxStates) {
+
+    uint64_t Duration = (uint64_t)(Seconds * 1e9);
+
+    InitMeshData();
+
+    pipelineRenderer Renderer = {0};
+    jobPool Pool;
+    Threads = CreateJobPool(&Pool, Threads);
+
+    static pipelineRun Run;
+    static inputQueue PipelineQueue;
+    inputQueue *Queue = &PipelineQueue;
+    Renderer.Background = malloc(60 * 60 * sizeof(color));
+    if(!Renderer.Background ||
+       !CreateRasterizer(&Renderer.Rasterizer, 384, 561, &Pool) ||
+       !InitAutopilot(&Run.Sim.Pilot, Horizon, MaxStates)) {
+        fprintf(stderr, "out of memory\n");
+        FreeAutopilot(&Run.Sim.Pilot);
+        FreePipelineRenderer(&Renderer);
+        DestroyJobPool(&Pool);
+        return 1;
+    }
+
+    matrix View = GetViewMatrix((v3){25.0f, 30.0f, -35.0f});
+    matrix Projection = GetProjectionMatrix(384.0f / 561.0f, 1.0f, 1.0f, 100.0f);
+    Renderer.ViewProjection = MultiplyMatrix(&View, &Projection);
+    Renderer.Visible = GetVisibleBounds(&Renderer.ViewProjection, 0.0f);
+
+    printf("real time:    %.1f s per loop, software backend 384x561 on %d threads, autopilot %d/%d\n",
+           Seconds, Threads, Horizon, MaxStates);
+
+    int Failed = 0;
+
+    for(int Pipelined = 0; Pipelined < 2; ++Pipelined) {
+
+        pipelineSimulation *Sim = &Run.Sim;
+        InitWorld(&Sim->World, Seed);
+        Sim->Clock = CreateStepClock(StepsPerSecond);
+        Sim->Queue = Queue;
+        memset(Queue, 0, sizeof(*Queue));
+
+        random TileRandom = Sim->World.Random;
+        JumpRandom(&TileRandom);
+        FillBackground(Renderer.Background, 60, 60, &TileRandom);
+        if(BakeBackground(&Renderer.BackgroundMesh, Renderer.Background, 60, 60, 0) < 0) {
+            fprintf(stderr, "out of memory\n");
+            Failed = 1;
+            break;
+        }
+
+        latencyStats FrameTimes = {0};
+        long Frames = 0;
+        long Backwards = 0;
+
+        uint64_t Start = GetMonotonicNanoseconds();
+        uint64_t End = Start + Duration;
+        Sim->Last = Start;
+
+        tapper Tapper = {Queue, End, Seed};
+        pthread_t Tap;
+        pthread_t Simulation;
+        pthread_create(&Tap, 0, TapThread, &Tapper);
+
+        if(Pipelined) {
+            frameState First = {.World = Sim->World, .StepTime = Start,
+                                .StepNanoseconds = NANOSECONDS_PER_SECOND / StepsPerSecond};
+            InitTripleBuffer(&Run.Frames, &First);
+            atomic_store(&Run.Quit, 0);
+            pthread_create(&Simulation, 0, SimulationThread, &Run);
+        }
+
+        uint64_t LastFrame = Start;
+        uint64_t LastStep = 0;
+
+        for(uint64_t Now = Start; Now < End; Now = GetMonotonicNanoseconds()) {
+            if(Frames) AddLatency(&FrameTimes, Now - LastFrame);
+            LastFrame = Now;
+
+            if(Pipelined) {
+                frameState *Frame = TakeFrame(&Run.Frames);
+                if(Frame->Step < LastStep) ++Backwards;
+                LastStep = Frame->Step;
+                DrawPipelineFrame(&Renderer, &Frame->World, GetFrameAlpha(Frame, Now));
+                MarkPresentedThrough(Queue, GetMonotonicNanoseconds(), Frame->Step);
+            } else {
+                RunDueSteps(Sim, Now);
+                DrawPipelineFrame(&Renderer, &Sim->World, Sim->World.Pause ? 1.0f : GetStepAlpha(&Sim->Clock));
+                MarkPresented(Queue, GetMonotonicNanoseconds());
+            }
+            ++Frames;
+        }
+
+        pthread_join(Tap, 0);
+        if(Pipelined) {
+            atomic_store(&Run.Quit, 1);
+            pthread_join(Simulation, 0);
+        }
+
+        // Taps the last frames did not get to show are not lost
+        long Lost = Tapper.Taps - Queue->ToSimulation.Count;
+        if(Lost > 0 || Backwards) Failed = 1;
+
+        char *Name = Pipelined ? "piped" : "serial";
+        printf("%-6s %6.1f fps, frame time mean %5.2f ms p99 %5.1f ms max %6.2f ms, %ld steps\n",
+               Name, Frames / Seconds, GetLatencyMean(&FrameTimes),
+               GetLatencyPercentile(&FrameTimes, 99.0), FrameTimes.Max / 1e6, (long)Sim->Clock.Steps);
+        PrintLatency("", Lost > 0 ? Lost : 0, Tapper.Taps, &Queue->ToSimulation, &Queue->ToPresent);
+        if(Pipelined) {
+            printf("       frames published %ld, drawn %ld, never drawn %ld, out of order %ld\n",
+                   Run.Frames.Published, Run.Frames.Taken, GetSkippedFrames(&Run.Frames), Backwards);
+        }
+    }
+
+    FreeAutopilot(&Run.Sim.Pilot);
+    FreePipelineRenderer(&Renderer);
+    DestroyJobPool(&Pool);
+    return Failed;
+}
+
+// Environment API driven like a trainer would, with a policy that only
+// looks at the observations: flap while below the middle of the next
+// gap. -batch sets the world count, -threads the threads.
+
+int RunEnvironment(long Steps, int Count, int Threads) {
+
+    environment Env;
+    if(!CreateEnvironment(&Env, Count, Seed, Threads)) {
+        fprintf(stderr, "CreateEnvironment failed\n");
+        return 1;
+    }
+
+    float *Observations = malloc((size_t)Count * ENV_OBSERVATION_SIZE * sizeof(float));
+    float *Rewards = malloc(Count * sizeof(float));
+    unsigned char *Dones = malloc(Count);
+    unsigned char *Actions = malloc(Count);
+
+    SetEnvironmentBuffers(&Env, Observations, Rewards, Dones);
+    ResetEnvironment(&Env);
+
+    double TotalReward = 0.0;
+    long Episodes = 0;
+    double Elapsed = 0.0;
+
+    for(long Step = 0; Step < Steps; ++Step) {
+        for(int World = 0; World < Count; ++World) {
+            float *Observation = Observations + World * ENV_OBSERVATION_SIZE;
+            float GapMiddle = (Observation[3] + Observation[4]) / 2.0f;
+            Actions[World] = Observation[0] < GapMiddle;
+        }
+
+        double Start = GetSeconds();
+        StepEnvironment(&Env, Actions);
+        Elapsed += GetSeconds() - Start;
+
+        for(int World = 0; World < Count; ++World) {
+            TotalReward += Rewards[World];
+            Episodes += Dones[World];
+        }
+    }
+
+    double WorldSteps = (double)Steps * Count;
+    printf("worlds:             %d\n", Count);
+    printf("threads:            %d\n", Env.Pool.ThreadCount);
+    printf("observation floats: %d\n", ENV_OBSERVATION_SIZE);
+    printf("world steps/second: %.0f (step calls only)\n", WorldSteps / Elapsed);
+    printf("episodes finished:  %ld\n", Episodes);
+    printf("reward per episode: %.2f\n", Episodes ? TotalReward / Episodes : 0.0);
+    printf("steps per episode:  %.1f\n", Episodes ? WorldSteps / Episodes : 0.0);
+
+    free(Actions);
+    free(Dones);
+    free(Rewards);
+    free(Observations);
+    FreeEnvironment(&Env);
+    return 0;
+}
+
+// Endless run soak test: the autopilot plays without practice mode
+// until Steps have run or the bird crashes. Reports the planner's
+// cloned world steps per second. Returns 1 on a crash.
+
+int RunAutopilotSoak(long Steps, int Horizon, int MaxStates) {
+
+    InitWorld(&World, Seed);
+    World.PracticeMode = 0;
+
+    autopilot Pilot;
+    if(!InitAutopilot(&Pilot, Horizon, MaxStates)) {
+        fprintf(stderr, "InitAutopilot failed\n");
+        return 1;
+    }
+
+    input Input = {0};
+    long Step = 0;
+
+    double Start = GetSeconds();
+    for(; Step < Steps && IsBotAlive(&World); ++Step) {
+        Input.Flap = RunAutopilot(&Pilot, &World);
+        UpdateWorld(&World, &Input);
+    }
+    double Elapsed = GetSeconds() - Start;
+
+    int Crashed = !IsBotAlive(&World);
+
+    printf("horizon:            %d ticks, up to %d states\n", Pilot.Horizon, Pilot.MaxStates);
+    printf("steps:              %ld%s\n", Step, Crashed ? " (crashed)" : "");
+    printf("score:              %d\n", World.Score);
+    printf("seconds:            %f\n", Elapsed);
+    printf("game steps/second:  %.0f\n", Step / Elapsed);
+    printf("nodes/decision:     %.1f\n", (double)Pilot.Nodes / Pilot.Decisions);
+    printf("nodes/second:       %.0f\n", Pilot.Nodes / Elapsed);
+    printf("clone size:         %zu bytes\n", sizeof(world));
+    printf("restarts:           %llu\n", (unsigned long long)Pilot.Restarts);
+
+    FreeAutopilot(&Pilot);
+    return Crashed;
+}
+
+// Checks snapshots while the hover bot plays Steps steps:
+//
+// - every step the world goes through the serialized form and has to
+//   come back with the same hash
+// - every RewindInterval steps the world goes back RewindSteps steps
+//   from the history, replays them, and has to end up where it was
+//
+// Then times save, restore, serialize and deserialize. With a SavePath
+// the last world is written there and read back. Returns 1 on a
+// mismatch.
+
+int RewindInterval = 100;
+int RewindSteps = 32;
+
+// Keeps the timed copies from being optimized away
+uint32_t SnapshotSink;
+
+int RunSnapshot(long Steps, char *SavePath) {
+
+    InitWorld(&World, Seed);
+
+    snapshotHistory History;
+    if(!CreateSnapshotHistory(&History, RewindSteps)) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    uint8_t Data[MAX_SNAPSHOT_SIZE];
+    size_t MaxSize = 0;
+    long Rewinds = 0;
+    int Result = 0;
+    input Input = {0};
+
+    for(long Step = 0; Step < Steps && !Result; ++Step) {
+        PushSnapshot(&History, &World);
+        Input.Flap = (World.Bird.Position.Y < HoverY);
+        UpdateWorld(&World, &Input);
+
+        world Copy;
+        size_t Size = SerializeWorld(&World, Data, sizeof(Data));
+        if(!Size || !DeserializeWorld(&Copy, Data, Size) || HashWorld(&Copy) != HashWorld(&World)) {
+            printf("serialized:   step %ld does not come back\n", Step);
+            Result = 1;
+        }
+        if(Size > MaxSize) MaxSize = Size;
+
+        if((Step + 1) % RewindInterval == 0) {
+            uint32_t Expected = HashWorld(&World);
+            int Back = RewindSnapshots(&History, &World, RewindSteps);
+            for(int Replayed = 0; Replayed < Back; ++Replayed) {
+                PushSnapshot(&History, &World);
+                Input.Flap = (World.Bird.Position.Y < HoverY);
+                UpdateWorld(&World, &Input);
+            }
+            if(HashWorld(&World) != Expected) {
+                printf("rewind:       step %ld back %d steps diverged\n", Step, Back);
+                Result = 1;
+            }
+            ++Rewinds;
+        }
+    }
+
+    // Timing
+
+    long Rounds = 1000000;
+    static snapshot Snapshots[16];
+    uint32_t Sink = 0;
+
+    double Start = GetSeconds();
+    for(long Round = 0; Round < Rounds; ++Round) {
+        SaveSnapshot(&Snapshots[Round & 15], &World);
+        Sink += Snapshots[Round & 15].Tick;
+    }
+    double SaveSeconds = GetSeconds() - Start;
+
+    Start = GetSeconds();
+    for(long Round = 0; Round < Rounds; ++Round) {
+        RestoreSnapshot(&World, &Snapshots[Round & 15]);
+        Sink += World.Tick;
+    }
+    double RestoreSeconds = GetSeconds() - Start;
+
+    size_t Size = 0;
+    Start = GetSeconds();
+    for(long Round = 0; Round < Rounds; ++Round) {
+        Size = SerializeWorld(&World, Data, sizeof(Data));
+        Sink += Data[Round % Size];
+    }
+    double SerializeSeconds = GetSeconds() - Start;
+
+    Start = GetSeconds();
+    for(long Round = 0; Round < Rounds; ++Round) {
+        Sink += (uint32_t)DeserializeWorld(&Snapshots[Round & 15], Data, Size);
+    }
+    double DeserializeSeconds = GetSeconds() - Start;
+    SnapshotSink = Sink;
+
+    if(SavePath) {
+        world Loaded;
+        if(!WriteSnapshot(&World, SavePath) || !ReadSnapshot(&Loaded, SavePath)) {
+            fprintf(stderr, "could not write and read back %s\n", SavePath);
+            Result = 1;
+        } else if(HashWorld(&Loaded) != HashWorld(&World)) {
+            printf("file:         %s does not come back\n", SavePath);
+            Result = 1;
+        }
+    }
+
+    printf("steps:        %ld, %ld rewinds of %d steps\n", Steps, Rewinds, RewindSteps);
+    printf("world size:   %zu bytes, serialized %zu now, %zu max seen, %d limit\n",
+           sizeof(world), Size, MaxSize, MAX_SNAPSHOT_SIZE);
+    printf("save:         %.1f ns\n", SaveSeconds * 1e9 / Rounds);
+    printf("restore:      %.1f ns\n", RestoreSeconds * 1e9 / Rounds);
+    printf("serialize:    %.1f ns\n", SerializeSeconds * 1e9 / Rounds);
+    printf("deserialize:  %.1f ns\n", DeserializeSeconds * 1e9 / Rounds);
+    if(!Result) {
+        printf("verified:     all snapshots come back\n");
+    }
+
+    FreeSnapshotHistory(&History);
+    return Result;
+}
+
+// Bot for the coarse stepping checks. Aims at the next gap plus an
+// offset that changes every pair, so some runs clip the pipes.
+
+int FlapTowards(world *World, float Offset) {
+    return World->Bird.Position.Y < GetNextGapY(World) + Offset;
+}
+
+float GetCoarseOffset(random *Random) {
+    return RandomZeroToOne(Random) * 12.0f - 6.0f;
+}
+
+// Compares coarse stepping of Ticks steps at a time against fine
+// stepping with the same inputs. Both worlds run on their own from the
+// same seed, nothing is copied from one to the other:
+//
+// - in practice mode, where hits only mark pipes, for Steps steps: the
+//   whole world after every coarse step, plus how far positions drift
+//   apart over the run
+// - without practice mode, whole games from seeds 1 to CoarseSeeds:
+//   the tick and score each game ends with, and the whole world
+//
+// Also counts the coarse steps with a hit that one overlap test at the
+// end of the step would have missed, and times both. Returns 1 on a
+// mismatch.
+
+int CoarseSeeds = 200;
+long CoarseTimedSteps = 1000000;
+int CoarseTimingRounds = 3;
+
+// Same world apart from the previous positions, which a coarse step
+// keeps from its start for the renderer to blend across
+int IsSameAsFine(world *Fine, world *Coarse) {
+    world Check = *Coarse;
+    Check.Bird.PreviousPosition = Fine->Bird.PreviousPosition;
+    memcpy(Check.Pipes.PreviousX, Fine->Pipes.PreviousX, sizeof(Check.Pipes.PreviousX));
+    return !memcmp(&Check, Fine, sizeof(world));
+}
+
+int RunCoarse(long Steps, int Ticks) {
+
+    static world Fine, Coarse;
+    InitWorld(&Fine, Seed);
+    InitWorld(&Coarse, Seed);
+
+    random Bot;
+    SeedRandom(&Bot, Seed);
+    float Offset = GetCoarseOffset(&Bot);
+    int Score = 0;
+
+    long Mismatches = 0;
+    long HitSteps = 0;
+    long Missed = 0;
+    float MaxBirdError = 0.0f;
+    float MaxPipeError = 0.0f;
+
+    for(long Step = 0; Step + Ticks <= Steps; Step += Ticks) {
+        input Input = {.Flap = FlapTowards(&Coarse, Offset)};
+
+        uint32_t HitsBefore = 0;
+        for(int Index = 0; Index < Fine.Pipes.Ring.Length; ++Index) {
+            HitsBefore |= (uint32_t)Fine.Pipes.Hit[Index] << Index;
+        }
+
+        for(int Tick = 0; Tick < Ticks; ++Tick) {
+            UpdateWorld(&Fine, &Input);
+        }
+        StepWorldCoarse(&Coarse, &Input, Ticks);
+
+        if(Coarse.Score != Score) {
+            Score = Coarse.Score;
+            Offset = GetCoarseOffset(&Bot);
+        }
+
+        // A step with a new hit, and whether the end of it overlaps
+
+        uint32_t HitsAfter = 0;
+        for(int Index = 0; Index < Fine.Pipes.Ring.Length; ++Index) {
+            HitsAfter |= (uint32_t)Fine.Pipes.Hit[Index] << Index;
+        }
+        if(HitsAfter & ~HitsBefore) {
+            ++HitSteps;
+            bird *Bird = &Fine.Bird;
+            collisionBox Box = {
+                Bird->Position.X - BirdWidth / 2.0f, Bird->Position.X + BirdWidth / 2.0f,
+                Bird->Position.Y + BirdHeight / 2.0f, Bird->Position.Y - BirdHeight / 2.0f,
+                PipeWidth / 2.0f, PipeHeight / 2.0f,
+            };
+            // Pipes move after the test, so it sees them one step back
+            float Tested[MAX_PIPES_AMOUNT];
+            for(int Index = 0; Index < Fine.Pipes.Ring.Length; ++Index) {
+                Tested[Index] = Fine.Pipes.X[Index] + DeltaTime * PipeSpeed;
+            }
+            if(!Kernels.PipesHit(Tested, Fine.Pipes.Y, Fine.Pipes.Ring.Length, &Box)) {
+                ++Missed;
+            }
+        }
+
+        if(!IsSameAsFine(&Fine, &Coarse)) {
+            if(!Mismatches) {
+                printf("mismatch:     first at tick %d, score %d/%d\n", Fine.Tick, Fine.Score, Coarse.Score);
+            }
+            ++Mismatches;
+        }
+
+        float BirdError = fabsf(Fine.Bird.Position.Y - Coarse.Bird.Position.Y);
+        if(BirdError > MaxBirdError) MaxBirdError = BirdError;
+        for(int Index = 0; Index < Fine.Pipes.Ring.Length; ++Index) {
+            float PipeError = fabsf(Fine.Pipes.X[Index] - Coarse.Pipes.X[Index]);
+            if(PipeError > MaxPipeError) MaxPipeError = PipeError;
+        }
+    }
+
+    // Whole games without practice mode
+
+    long Games = 0;
+    long EndMismatches = 0;
+    long GameTicks = 0;
+
+    for(int GameSeed = 1; GameSeed <= CoarseSeeds; ++GameSeed) {
+        InitWorld(&Fine, GameSeed);
+        InitWorld(&Coarse, GameSeed);
+        Fine.PracticeMode = Coarse.PracticeMode = 0;
+        SeedRandom(&Bot, GameSeed);
+        Offset = GetCoarseOffset(&Bot);
+        Score = 0;
+
+        while(Coarse.Running && Coarse.Tick < Steps) {
+            input Input = {.Flap = FlapTowards(&Coarse, Offset)};
+            for(int Tick = 0; Tick < Ticks && Fine.Running; ++Tick) {
+                UpdateWorld(&Fine, &Input);
+            }
+            StepWorldCoarse(&Coarse, &Input, Ticks);
+            if(Coarse.Score != Score) {
+                Score = Coarse.Score;
+                Offset = GetCoarseOffset(&Bot);
+            }
+        }
+
+        ++Games;
+        GameTicks += Fine.Tick;
+        if(Fine.Running != Coarse.Running || Fine.Tick != Coarse.Tick || Fine.Score != Coarse.Score ||
+           !IsSameAsFine(&Fine, &Coarse)) {
+            if(!EndMismatches) {
+                printf("game:         seed %d ends at tick %d score %d fine, tick %d score %d coarse\n",
+                       GameSeed, Fine.Tick, Fine.Score, Coarse.Tick, Coarse.Score);
+            }
+            ++EndMismatches;
+        }
+    }
+
+    // Timing, hover bot in practice mode. Best of a few rounds of at
+    // least CoarseTimedSteps steps, short runs would only time noise.
+
+    long Timed = (Steps > CoarseTimedSteps ? Steps : CoarseTimedSteps) / Ticks * Ticks;
+    double FineSeconds = 1e30;
+    double CoarseSeconds = 1e30;
+
+    for(int Round = 0; Round < CoarseTimingRounds; ++Round) {
+        InitWorld(&Fine, Seed);
+        double Start = GetSeconds();
+        for(long Step = 0; Step < Timed; ++Step) {
+            input Input = {.Flap = (Fine.Bird.Position.Y < HoverY)};
+            UpdateWorld(&Fine, &Input);
+        }
+        double Seconds = GetSeconds() - Start;
+        if(Seconds < FineSeconds) FineSeconds = Seconds;
+
+        InitWorld(&Coarse, Seed);
+        Start = GetSeconds();
+        for(long Step = 0; Step < Timed; Step += Ticks) {
+            input Input = {.Flap = (Coarse.Bird.Position.Y < HoverY)};
+            StepWorldCoarse(&Coarse, &Input, Ticks);
+        }
+        Seconds = GetSeconds() - Start;
+        if(Seconds < CoarseSeconds) CoarseSeconds = Seconds;
+    }
+
+    printf("coarse step:  %d ticks, %.3f s\n", Ticks, Ticks * DeltaTime);
+    printf("steps:        %ld, %ld coarse steps differ\n", Steps, Mismatches);
+    printf("hits:         %ld coarse steps with a hit, %ld missed by one test at the end\n", HitSteps, Missed);
+    printf("drift:        bird %g, pipes %g over the run\n", MaxBirdError, MaxPipeError);
+    printf("games:        %ld, %ld ticks, %ld end differently\n", Games, GameTicks, EndMismatches);
+    printf("fine:         %.0f steps/second, best of %d x %ld steps\n", Timed / FineSeconds, CoarseTimingRounds, Timed);
+    printf("coarse:       %.0f steps/second, %.1fx\n", Timed / CoarseSeconds, FineSeconds / CoarseSeconds);
+
+    return Mismatches || EndMismatches;
+}
+
+// The autopilot plays Seconds of game time in real time, every step is
+// drawn with the software backend and captured to Path. Reports what
+// capturing cost the playing thread and how the writer kept up.
+// Returns 1 if the file could not be written.
+
+int RunCapture(char *Path, double Seconds, int QueueFrames, int Threads, int Horizon, int MaxStates) {
+
+    InitMeshData();
+    InitWorld(&World, Seed);
+    World.PracticeMode = 0;
+
+    pipelineRenderer Renderer = {0};
+    jobPool Pool;
+    Threads = CreateJobPool(&Pool, Threads);
+
+    autopilot Pilot = {0};
+    Renderer.Background = malloc(60 * 60 * sizeof(color));
+    if(!Renderer.Background ||
+       !CreateRasterizer(&Renderer.Rasterizer, 384, 561, &Pool) ||
+       !InitAutopilot(&Pilot, Horizon, MaxStates)) {
+        fprintf(stderr, "out of memory\n");
+        FreeAutopilot(&Pilot);
+        FreePipelineRenderer(&Renderer);
+        DestroyJobPool(&Pool);
+        return 1;
+    }
+
+    random TileRandom = World.Random;
+    JumpRandom(&TileRandom);
+    FillBackground(Renderer.Background, 60, 60, &TileRandom);
+    if(BakeBackground(&Renderer.BackgroundMesh, Renderer.Background, 60, 60, 0) < 0) {
+        fprintf(stderr, "out of memory\n");
+        FreeAutopilot(&Pilot);
+        FreePipelineRenderer(&Renderer);
+        DestroyJobPool(&Pool);
+        return 1;
+    }
+
+    matrix View = GetViewMatrix((v3){25.0f, 30.0f, -35.0f});
+    matrix Projection = GetProjectionMatrix(384.0f / 561.0f, 1.0f, 1.0f, 100.0f);
+    Renderer.ViewProjection = MultiplyMatrix(&View, &Projection);
+    Renderer.Visible = GetVisibleBounds(&Renderer.ViewProjection, 0.0f);
+
+    capture Capture;
+    if(!StartCapture(&Capture, Path, 384, 561, StepsPerSecond, QueueFrames)) {
+        fprintf(stderr, "could not capture to %s\n", Path);
+        FreeAutopilot(&Pilot);
+        FreePipelineRenderer(&Renderer);
+        DestroyJobPool(&Pool);
+        return 1;
+    }
+
+    latencyStats CaptureTimes = {0};
+    latencyStats Lateness = {0};
+    long Steps = (long)(Seconds * StepsPerSecond);
+    input Input = {0};
+
+    uint64_t Start = GetMonotonicNanoseconds();
+    for(long Step = 0; Step < Steps; ++Step) {
+        uint64_t Due = Start + (uint64_t)Step * NANOSECONDS_PER_SECOND / StepsPerSecond;
+        uint64_t Now = GetMonotonicNanoseconds();
+        if(Due > Now) SleepNanoseconds(Due - Now);
+        AddLatency(&Lateness, Now > Due ? Now - Due : 0);
+
+        Input.Flap = RunAutopilot(&Pilot, &World);
+        UpdateWorld(&World, &Input);
+        DrawPipelineFrame(&Renderer, &World, 1.0f);
+
+        uint64_t Before = GetMonotonicNanoseconds();
+        CaptureFrame(&Capture, &Renderer.Rasterizer.Target);
+        AddLatency(&CaptureTimes, GetMonotonicNanoseconds() - Before);
+    }
+    uint64_t Played = GetMonotonicNanoseconds() - Start;
+
+    uint64_t DrainStart = GetMonotonicNanoseconds();
+    int Written = StopCapture(&Capture);
+    double Drain = NanosecondsToSeconds(GetMonotonicNanoseconds() - DrainStart);
+
+    double Busy = NanosecondsToSeconds(Capture.WriteNanoseconds);
+    double Megabytes = Capture.Bytes / 1e6;
+
+    printf("capture:      %s, %s %dx%d at %d fps, queue of %d frames, %d render threads\n",
+           Path, Capture.Format == CAPTURE_Y4M ? "y4m 4:4:4" : "raw rgba",
+           Capture.Width, Capture.Height, Capture.FramesPerSecond, Capture.Capacity, Threads);
+    printf("frames:       %ld captured, %ld written, %ld dropped, at most %d queued\n",
+           Capture.Captured, Capture.Written, Capture.Dropped, Capture.MaxQueued);
+    printf("played:       %.2f s, score %d, steps late mean %.2f ms max %.2f ms\n",
+           NanosecondsToSeconds(Played), World.Score, GetLatencyMean(&Lateness), Lateness.Max / 1e6);
+    printf("caller:       capture mean %.3f ms max %.3f ms per frame\n",
+           GetLatencyMean(&CaptureTimes), CaptureTimes.Max / 1e6);
+    printf("writer:       %.1f MB, %.2f ms per frame, %.0f MB/s while busy, busy %.0f%% of the run\n",
+           Megabytes, Capture.Written ? Busy * 1e3 / Capture.Written : 0.0,
+           Busy > 0.0 ? Megabytes / Busy : 0.0, 100.0 * Busy / NanosecondsToSeconds(Played));
+    printf("drain:        %.3f s after the last frame\n", Drain);
+    if(!Written) printf("error:        could not write %s\n", Path);
+
+    FreeAutopilot(&Pilot);
+    FreePipelineRenderer(&Renderer);
+    DestroyJobPool(&Pool);
+    return !Written;
+}
+
+int main(int ArgumentCount, char **Arguments) {
+
+    SelectKernels();
+
+    long Steps = 1000000;
+    int BatchCount = 0;
+    int Threads = 1;
+    int MaxThreads = 0;
+    long KernelRounds = 0;
+    long RandomCount = 0;
+    int Frames = 0;
+    char *RenderPath = 0;
+    char *GoldenPath = 0;
+    char *RecordPath = 0;
+    char *ReplayPath = 0;
+    char *ProfilePath = 0;
+    double DriftHours = 0.0;
+    double LatencySeconds = 0.0;
+    double PacingSeconds = 0.0;
+    long EnvSteps = 0;
+    long AutopilotSteps = 0;
+    int Horizon = 120;
+    int MaxStates = 512;
+    long SnapshotSteps = 0;
+    char *SavePath = 0;
+    int CoarseTicks = 0;
+    double PipelineSeconds = 0.0;
+    char *CapturePath = 0;
+    double CaptureSeconds = 10.0;
+    int QueueFrames = 8;
+
+    for(int Index = 1; Index + 1 < ArgumentCount; Index += 2) {
+        char *Name = Arguments[Index];
+        char *Value = Arguments[Index + 1];
+        if(!strcmp(Name, "-steps")) Steps = atol(Value);
+        else if(!strcmp(Name, "-seed")) Seed = (unsigned int)atol(Value);
+        else if(!strcmp(Name, "-batch")) BatchCount = atoi(Value);
+        else if(!strcmp(Name, "-threads")) Threads = atoi(Value);
+        else if(!strcmp(Name, "-scaling")) MaxThreads = atoi(Value);
+        else if(!strcmp(Name, "-kernels")) KernelRounds = atol(Value);
+        else if(!strcmp(Name, "-random")) RandomCount = atol(Value);
+        else if(!strcmp(Name, "-frames")) Frames = atoi(Value);
+        else if(!strcmp(Name, "-render")) RenderPath = Value;
+        else if(!strcmp(Name, "-golden")) GoldenPath = Value;
+        else if(!strcmp(Name, "-record")) RecordPath = Value;
+        else if(!strcmp(Name, "-replay")) ReplayPath = Value;
+        else if(!strcmp(Name, "-profile")) ProfilePath = Value;
+        else if(!strcmp(Name, "-drift")) DriftHours = atof(Value);
+        else if(!strcmp(Name, "-latency")) LatencySeconds = atof(Value);
+        else if(!strcmp(Name, "-pacing")) PacingSeconds = atof(Value);
+        else if(!strcmp(Name, "-env")) EnvSteps = atol(Value);
+        else if(!strcmp(Name, "-autopilot")) AutopilotSteps = atol(Value);
+        else if(!strcmp(Name, "-horizon")) Horizon = atoi(Value);
+        else if(!strcmp(Name, "-states")) MaxStates = atoi(Value);
+        else if(!strcmp(Name, "-snapshot")) SnapshotSteps = atol(Value);
+        else if(!strcmp(Name, "-save")) SavePath = Value;
+        else if(!strcmp(Name, "-coarse")) CoarseTicks = atoi(Value);
+        else if(!strcmp(Name, "-pipeline")) PipelineSeconds = atof(Value);
+        else if(!strcmp(Name, "-capture")) CapturePath = Value;
+        else if(!strcmp(Name, "-seconds")) CaptureSeconds = atof(Value);
+        else if(!strcmp(Name, "-queue")) QueueFrames = atoi(Value);
+        else {
+            fprintf(stderr, "unknown option %s\n", Name);
+            return 1;
+        }
+    }
+
+    if(CapturePath) {
+        return RunCapture(CapturePath, CaptureSeconds, QueueFrames, Threads, Horizon, MaxStates);
+    } else if(PipelineSeconds > 0.0) {
+        return RunPipeline(PipelineSeconds, Threads, Horizon, MaxStates);
+    } else if(CoarseTicks > 0) {
+        return RunCoarse(Steps, CoarseTicks);
+    } else if(SnapshotSteps > 0) {
+        return RunSnapshot(SnapshotSteps, SavePath);
+    } else if(AutopilotSteps > 0) {
+        return RunAutopilotSoak(AutopilotSteps, Horizon, MaxStates);
+    } else if(EnvSteps > 0) {
+        return RunEnvironment(EnvSteps, BatchCount > 0 ? BatchCount : 4096, Threads);
+    } else if(PacingSeconds > 0.0) {
+        return RunPacing(PacingSeconds);
+    } else if(LatencySeconds > 0.0) {
+        return RunLatency(LatencySeconds);
+    } else if(DriftHours > 0.0) {
+        return RunDrift(DriftHours);
+    } else if(ProfilePath) {
+        return RunProfile(Steps, Threads, ProfilePath);
+    } else if(ReplayPath) {
+        return RunReplay(ReplayPath);
+    } else if(RenderPath || GoldenPath) {
+        return RunRender(Steps, Threads, RenderPath, GoldenPath);
+    } else if(Frames) {
+        RunFrames(Steps);
+    } else if(RandomCount > 0) {
+        RunRandom(RandomCount);
+    } else if(KernelRounds > 0) {
+        RunKernels(KernelRounds);
+    } else if(MaxThreads > 0) {
+        RunScaling(Steps, BatchCount > 0 ? BatchCount : 65536, MaxThreads);
+    } else if(BatchCount > 0) {
+        RunBatch(Steps, BatchCount, Threads, 0);
+    } else {
+        RunWorld(Steps, RecordPath);
+    }
+
+    return 0;
+}
@@ -0,0 +1,223 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+// Thread pool that splits a range of items into chunks and lets idle
+// workers steal chunks from busy ones. The calling thread is worker 0
+// and RunJob() returns once every chunk is done.
+//
+// Each worker owns a range of chunk indices packed into one 64-bit word
+// (begin in the high half, end in the low half). The owner takes chunks
+// from the front, thieves take the back half of someone else's range.
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+
+#define MAX_THREADS 64
+
+typedef void jobFunction(void *Data, int First, int Last);
+
+typedef struct {
+    _Alignas(64) _Atomic uint64_t Range;
+} jobQueue;
+
+typedef struct jobPool jobPool;
+
+typedef struct {
+    jobPool *Pool;
+    int Index;
+    long Chunks;
+    long Steals;
+} jobWorker;
+
+struct jobPool {
+    int ThreadCount;
+    pthread_t Threads[MAX_THREADS];
+    jobWorker Workers[MAX_THREADS];
+    jobQueue Queues[MAX_THREADS];
+
+    pthread_mutex_t Mutex;
+    pthread_cond_t Wake;
+    int Generation;
+    int Quit;
+
+    _Atomic int Remaining;
+    _Atomic int Active;
+
+    jobFunction *Function;
+    void *Data;
+    int ItemCount;
+    int ChunkSize;
+};
+
+uint64_t PackRange(uint32_t Begin, uint32_t End) {
+    return ((uint64_t)Begin << 32) | End;
+}
+
+int PopChunk(jobQueue *Queue) {
+    uint64_t Range = atomic_load(&Queue->Range);
+    for(;;) {
+        uint32_t Begin = (uint32_t)(Range >> 32);
+        uint32_t End = (uint32_t)Range;
+        if(Begin >= End) return -1;
+        if(atomic_compare_exchange_weak(&Queue->Range, &Range, PackRange(Begin + 1, End))) {
+            return (int)Begin;
+        }
+    }
+}
+
+// Moves the back half of a victim's range into the thief's queue.
+
+int StealChunks(jobQueue *Victim, jobQueue *Thief) {
+    uint64_t Range = atomic_load(&Victim->Range);
+    for(;;) {
+        uint32_t Begin = (uint32_t)(Range >> 32);
+        uint32_t End = (uint32_t)Range;
+        if(Begin >= End) return 0;
+        uint32_t Amount = (End - Begin + 1) / 2;
+        if(atomic_compare_exchange_weak(&Victim->Range, &Range, PackRange(Begin, End - Amount))) {
+            atomic_store(&Thief->Range, PackRange(End - Amount, End));
+            return 1;
+        }
+    }
+}
+
+void RunChunk(jobPool *Pool, int Chunk) {
+    int First = Chunk * Pool->ChunkSize;
+    int Last = First + Pool->ChunkSize;
+    if(Last > Pool->ItemCount) Last = Pool->ItemCount;
+    Pool->Function(Pool->Data, First, Last);
+    atomic_fetch_sub(&Pool->Remaining, 1);
+}
+
+void DoWork(jobWorker *Worker) {
+    jobPool *Pool = Worker->Pool;
+    jobQueue *Own = &Pool->Queues[Worker->Index];
+
+    while(atomic_load(&Pool->Remaining) > 0) {
+
+        int Chunk = PopChunk(Own);
+        if(Chunk >= 0) {
+            RunChunk(Pool, Chunk);
+            ++Worker->Chunks;
+            continue;
+        }
+
+        // Nothing left here, go look at the others
+
+        int Stolen = 0;
+        for(int Offset = 1; Offset < Pool->ThreadCount && !Stolen; ++Offset) {
+            int Victim = (Worker->Index + Offset) % Pool->ThreadCount;
+            Stolen = StealChunks(&Pool->Queues[Victim], Own);
+        }
+
+        if(Stolen) {
+            ++Worker->Steals;
+        } else {
+            sched_yield();
+        }
+    }
+}
+
+void *WorkerThread(void *Parameter) {
+    jobWorker *Worker = Parameter;
+    jobPool *Pool = Worker->Pool;
+    int Generation = 0;
+
+    for(;;) {
+        pthread_mutex_lock(&Pool->Mutex);
+        while(Pool->Generation == Generation && !Pool->Quit) {
+            pthread_cond_wait(&Pool->Wake, &Pool->Mutex);
+        }
+        Generation = Pool->Generation;
+        int Quit = Pool->Quit;
+        pthread_mutex_unlock(&Pool->Mutex);
+
+        if(Quit) break;
+
+        DoWork(Worker);
+        atomic_fetch_sub(&Pool->Active, 1);
+    }
+
+    return 0;
+}
+
+int CreateJobPool(jobPool *Pool, int ThreadCount) {
+
+    if(ThreadCount < 1) ThreadCount = 1;
+    if(ThreadCount > MAX_THREADS) ThreadCount = MAX_THREADS;
+
+    memset(Pool, 0, sizeof(*Pool));
+    Pool->ThreadCount = ThreadCount;
+    pthread_mutex_init(&Pool->Mutex, 0);
+    pthread_cond_init(&Pool->Wake, 0);
+
+    for(int Index = 0; Index < ThreadCount; ++Index) {
+        Pool->Workers[Index] = (jobWorker){.Pool = Pool, .Index = Index};
+        atomic_init(&Pool->Queues[Index].Range, 0);
+    }
+
+    for(int Index = 1; Index < ThreadCount; ++Index) {
+        if(pthread_create(&Pool->Threads[Index], 0, WorkerThread, &Pool->Workers[Index])) {
+            Pool->ThreadCount = Index;
+            break;
+        }
+    }
+
+    return Pool->ThreadCount;
+}
+
+void DestroyJobPool(jobPool *Pool) {
+    pthread_mutex_lock(&Pool->Mutex);
+    Pool->Quit = 1;
+    pthread_cond_broadcast(&Pool->Wake);
+    pthread_mutex_unlock(&Pool->Mutex);
+
+    for(int Index = 1; Index < Pool->ThreadCount; ++Index) {
+        pthread_join(Pool->Threads[Index], 0);
+    }
+
+    pthread_mutex_destroy(&Pool->Mutex);
+    pthread_cond_destroy(&Pool->Wake);
+}
+
+// Calls Function on chunks of ChunkSize items until all ItemCount items
+// are covered. Chunks start out evenly split between the workers.
+
+void RunJob(jobPool *Pool, jobFunction *Function, void *Data, int ItemCount, int ChunkSize) {
+
+    if(ItemCount <= 0) return;
+    if(ChunkSize < 1) ChunkSize = 1;
+
+    int ChunkCount = (ItemCount + ChunkSize - 1) / ChunkSize;
+
+    Pool->Function = Function;
+    Pool->Data = Data;
+    Pool->ItemCount = ItemCount;
+    Pool->ChunkSize = ChunkSize;
+
+    for(int Index = 0; Index < Pool->ThreadCount; ++Index) {
+        uint32_t Begin = (uint32_t)((long)ChunkCount * Index / Pool->ThreadCount);
+        uint32_t End = (uint32_t)((long)ChunkCount * (Index + 1) / Pool->ThreadCount);
+        atomic_store(&Pool->Queues[Index].Range, PackRange(Begin, End));
+    }
+
+    atomic_store(&Pool->Remaining, ChunkCount);
+    atomic_store(&Pool->Active, Pool->ThreadCount - 1);
+
+    pthread_mutex_lock(&Pool->Mutex);
+    ++Pool->Generation;
+    pthread_cond_broadcast(&Pool->Wake);
+    pthread_mutex_unlock(&Pool->Mutex);
+
+    DoWork(&Pool->Workers[0]);
+
+    // Workers may still be looking for something to steal
+
+    while(atomic_load(&Pool->Active) > 0) {
+        sched_yield();
+    }
+}
+
+#endif
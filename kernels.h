@@ -0,0 +1,252 @@
+#ifndef KERNELS_H
+#define KERNELS_H
+
+// Hot loops over packed float arrays: bird vs pipe collision and moving
+// things along X. Each has a scalar version and, on x86, SSE (4 wide)
+// and AVX2 (8 wide) versions. SelectKernels() picks the widest one the
+// CPU supports; until it is called the scalar ones are used. It writes
+// the global Kernels table, so programs call it once at startup before
+// any thread steps a world.
+//
+// The vector versions do the same float operations as the scalar ones
+// so all of them give bit-identical results.
+
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define KERNELS_X86 1
+#if defined(_MSC_VER)
+#include <intrin.h>
+#include <immintrin.h>
+#define TARGET_AVX2
+#else
+#include <immintrin.h>
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+// Bird rectangle and pipe half extents
+typedef struct {
+    float Left;
+    float Right;
+    float Top;
+    float Bottom;
+    float HalfWidth;
+    float HalfHeight;
+} collisionBox;
+
+// Returns a bit per pipe that overlaps the box, Count <= 32
+typedef uint32_t pipesHitFunction(float *X, float *Y, int Count, collisionBox *Box);
+
+// X -= Step for every entry, returns a bit per entry that went from
+// >= LineX to < LineX, Count <= 32
+typedef uint32_t movePipesFunction(float *X, int Count, float Step, float LineX);
+
+// X -= Step for every entry
+typedef void advanceXFunction(float *X, int Count, float Step);
+
+typedef struct {
+    char *Name;
+    pipesHitFunction *PipesHit;
+    movePipesFunction *MovePipes;
+    advanceXFunction *AdvanceX;
+} kernels;
+
+int CountBits(uint32_t Mask) {
+    int Count = 0;
+    for(; Mask; Mask &= Mask - 1) {
+        ++Count;
+    }
+    return Count;
+}
+
+// Scalar
+
+uint32_t PipesHitScalar(float *X, float *Y, int Count, collisionBox *Box) {
+    uint32_t Mask = 0;
+    for(int Index = 0; Index < Count; ++Index) {
+        float Left = X[Index] - Box->HalfWidth;
+        float Right = X[Index] + Box->HalfWidth;
+        float Top = Y[Index] + Box->HalfHeight;
+        float Bottom = Y[Index] - Box->HalfHeight;
+        int Hit = (Box->Left <= Right) & (Left <= Box->Right) &
+                  (Box->Bottom <= Top) & (Bottom <= Box->Top);
+        Mask |= (uint32_t)Hit << Index;
+    }
+    return Mask;
+}
+
+uint32_t MovePipesScalar(float *X, int Count, float Step, float LineX) {
+    uint32_t Mask = 0;
+    for(int Index = 0; Index < Count; ++Index) {
+        float Old = X[Index];
+        X[Index] = Old - Step;
+        int Crossed = (Old >= LineX) & (X[Index] < LineX);
+        Mask |= (uint32_t)Crossed << Index;
+    }
+    return Mask;
+}
+
+void AdvanceXScalar(float *X, int Count, float Step) {
+    for(int Index = 0; Index < Count; ++Index) {
+        X[Index] -= Step;
+    }
+}
+
+#ifdef KERNELS_X86
+
+// SSE
+
+uint32_t PipesHitSSE(float *X, float *Y, int Count, collisionBox *Box) {
+    __m128 BoxLeft = _mm_set1_ps(Box->Left);
+    __m128 BoxRight = _mm_set1_ps(Box->Right);
+    __m128 BoxTop = _mm_set1_ps(Box->Top);
+    __m128 BoxBottom = _mm_set1_ps(Box->Bottom);
+    __m128 HalfWidth = _mm_set1_ps(Box->HalfWidth);
+    __m128 HalfHeight = _mm_set1_ps(Box->HalfHeight);
+
+    uint32_t Mask = 0;
+    int Index = 0;
+    for(; Index + 4 <= Count; Index += 4) {
+        __m128 PipeX = _mm_loadu_ps(X + Index);
+        __m128 PipeY = _mm_loadu_ps(Y + Index);
+        __m128 Hit = _mm_cmple_ps(BoxLeft, _mm_add_ps(PipeX, HalfWidth));
+        Hit = _mm_and_ps(Hit, _mm_cmple_ps(_mm_sub_ps(PipeX, HalfWidth), BoxRight));
+        Hit = _mm_and_ps(Hit, _mm_cmple_ps(BoxBottom, _mm_add_ps(PipeY, HalfHeight)));
+        Hit = _mm_and_ps(Hit, _mm_cmple_ps(_mm_sub_ps(PipeY, HalfHeight), BoxTop));
+        Mask |= (uint32_t)_mm_movemask_ps(Hit) << Index;
+    }
+    if(Index < Count) {
+        Mask |= PipesHitScalar(X + Index, Y + Index, Count - Index, Box) << Index;
+    }
+    return Mask;
+}
+
+uint32_t MovePipesSSE(float *X, int Count, float Step, float LineX) {
+    __m128 Steps = _mm_set1_ps(Step);
+    __m128 Line = _mm_set1_ps(LineX);
+
+    uint32_t Mask = 0;
+    int Index = 0;
+    for(; Index + 4 <= Count; Index += 4) {
+        __m128 Old = _mm_loadu_ps(X + Index);
+        __m128 New = _mm_sub_ps(Old, Steps);
+        _mm_storeu_ps(X + Index, New);
+        __m128 Crossed = _mm_and_ps(_mm_cmpge_ps(Old, Line), _mm_cmplt_ps(New, Line));
+        Mask |= (uint32_t)_mm_movemask_ps(Crossed) << Index;
+    }
+    if(Index < Count) {
+        Mask |= MovePipesScalar(X + Index, Count - Index, Step, LineX) << Index;
+    }
+    return Mask;
+}
+
+void AdvanceXSSE(float *X, int Count, float Step) {
+    __m128 Steps = _mm_set1_ps(Step);
+    int Index = 0;
+    for(; Index + 4 <= Count; Index += 4) {
+        _mm_storeu_ps(X + Index, _mm_sub_ps(_mm_loadu_ps(X + Index), Steps));
+    }
+    AdvanceXScalar(X + Index, Count - Index, Step);
+}
+
+// AVX2
+
+TARGET_AVX2 uint32_t PipesHitAVX2(float *X, float *Y, int Count, collisionBox *Box) {
+    __m256 BoxLeft = _mm256_set1_ps(Box->Left);
+    __m256 BoxRight = _mm256_set1_ps(Box->Right);
+    __m256 BoxTop = _mm256_set1_ps(Box->Top);
+    __m256 BoxBottom = _mm256_set1_ps(Box->Bottom);
+    __m256 HalfWidth = _mm256_set1_ps(Box->HalfWidth);
+    __m256 HalfHeight = _mm256_set1_ps(Box->HalfHeight);
+
+    uint32_t Mask = 0;
+    int Index = 0;
+    for(; Index + 8 <= Count; Index += 8) {
+        __m256 PipeX = _mm256_loadu_ps(X + Index);
+        __m256 PipeY = _mm256_loadu_ps(Y + Index);
+        __m256 Hit = _mm256_cmp_ps(BoxLeft, _mm256_add_ps(PipeX, HalfWidth), _CMP_LE_OQ);
+        Hit = _mm256_and_ps(Hit, _mm256_cmp_ps(_mm256_sub_ps(PipeX, HalfWidth), BoxRight, _CMP_LE_OQ));
+        Hit = _mm256_and_ps(Hit, _mm256_cmp_ps(BoxBottom, _mm256_add_ps(PipeY, HalfHeight), _CMP_LE_OQ));
+        Hit = _mm256_and_ps(Hit, _mm256_cmp_ps(_mm256_sub_ps(PipeY, HalfHeight), BoxTop, _CMP_LE_OQ));
+        Mask |= (uint32_t)_mm256_movemask_ps(Hit) << Index;
+    }
+    // Scalar tail compiled for AVX2 as well, calling into the SSE
+    // version from here would mix VEX and legacy encodings
+    for(; Index < Count; ++Index) {
+        int Hit = (Box->Left <= X[Index] + Box->HalfWidth) & (X[Index] - Box->HalfWidth <= Box->Right) &
+                  (Box->Bottom <= Y[Index] + Box->HalfHeight) & (Y[Index] - Box->HalfHeight <= Box->Top);
+        Mask |= (uint32_t)Hit << Index;
+    }
+    return Mask;
+}
+
+TARGET_AVX2 uint32_t MovePipesAVX2(float *X, int Count, float Step, float LineX) {
+    __m256 Steps = _mm256_set1_ps(Step);
+    __m256 Line = _mm256_set1_ps(LineX);
+
+    uint32_t Mask = 0;
+    int Index = 0;
+    for(; Index + 8 <= Count; Index += 8) {
+        __m256 Old = _mm256_loadu_ps(X + Index);
+        __m256 New = _mm256_sub_ps(Old, Steps);
+        _mm256_storeu_ps(X + Index, New);
+        __m256 Crossed = _mm256_and_ps(_mm256_cmp_ps(Old, Line, _CMP_GE_OQ),
+                                       _mm256_cmp_ps(New, Line, _CMP_LT_OQ));
+        Mask |= (uint32_t)_mm256_movemask_ps(Crossed) << Index;
+    }
+    for(; Index < Count; ++Index) {
+        float Old = X[Index];
+        X[Index] = Old - Step;
+        Mask |= (uint32_t)((Old >= LineX) & (X[Index] < LineX)) << Index;
+    }
+    return Mask;
+}
+
+TARGET_AVX2 void AdvanceXAVX2(float *X, int Count, float Step) {
+    __m256 Steps = _mm256_set1_ps(Step);
+    int Index = 0;
+    for(; Index + 8 <= Count; Index += 8) {
+        _mm256_storeu_ps(X + Index, _mm256_sub_ps(_mm256_loadu_ps(X + Index), Steps));
+    }
+    for(; Index < Count; ++Index) {
+        X[Index] -= Step;
+    }
+}
+
+int CpuHasAVX2() {
+#if defined(_MSC_VER)
+    int Info[4];
+    __cpuid(Info, 0);
+    if(Info[0] < 7) return 0;
+    __cpuid(Info, 1);
+    int OSXSave = (Info[2] >> 27) & 1;
+    int AVX = (Info[2] >> 28) & 1;
+    if(!OSXSave || !AVX || (_xgetbv(0) & 6) != 6) return 0;
+    __cpuidex(Info, 7, 0);
+    return (Info[1] >> 5) & 1;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif
+
+kernels KernelsScalar = {"scalar", PipesHitScalar, MovePipesScalar, AdvanceXScalar};
+#ifdef KERNELS_X86
+kernels KernelsSSE = {"sse", PipesHitSSE, MovePipesSSE, AdvanceXSSE};
+kernels KernelsAVX2 = {"avx2", PipesHitAVX2, MovePipesAVX2, AdvanceXAVX2};
+#endif
+
+kernels Kernels = {"scalar", PipesHitScalar, MovePipesScalar, AdvanceXScalar};
+
+void SelectKernels() {
+#ifdef KERNELS_X86
+    Kernels = CpuHasAVX2() ? KernelsAVX2 : KernelsSSE;
+#else
+    Kernels = KernelsScalar;
+#endif
+}
+
+#endif
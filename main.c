@@ -1,347 +1,359 @@
 #include "engine.h"
-
-#define MAX_ARRAY_LENGTH 4096
-#define MAX_TRAIL_LENGTH 15
-#define MAX_PIPES_AMOUNT 10
-
-enum {BIRD, PIPE, TRAIL};
-
-typedef struct { 
-    v3 Position;
-    v3 Velocity;
-    v3 MaxVelocity;
-    mesh Mesh;
-    color Color;
-    int Type;
-    int Hit;
-} entity;
-
-typedef struct {
-    entity Entities[MAX_ARRAY_LENGTH];
-    int Length;
-    int Capacity;
-    int Index;
-} entityArray;
-
-typedef struct {
-    float Left;
-    float Right;
-    float Top;
-    float Bottom;
-} rectangle;
+#include "game.h"
+#include "replay.h"
+#include "autopilot.h"
+#include "pipeline.h"
 
 // Globals
 
-int PracticeMode = 1;
-float Gravity = 9.81f;
 int XTiles = 60;
 int YTiles = 60;
-int Pause;
-
-timer PipeTimer;
-timer TrailTimer;
-
-color ColorBird = {0.1f, 0.9f, 0.3f, 1.0f};
-color ColorPipe= {0.4f, 0.2f, 0.9f, 1.0f};
-color ColorPipePractice = {0.3f, 0.3f, 0.3f, 1.0f};
-color ColorPipeHit = {0.5f, 0.5f, 0.5f, 1.0f};
-color ColorBackground = {0.2f, 0.2f, 0.2f, 1.0f};
-color ColorBackgroundLighter = {0.21f, 0.21f, 0.21f, 1.0f};
-color ColorTrail = {0.3f, 0.3f, 0.3f, 1.0f};
-
-entity Bird;
-entityArray Trail = {.Capacity = MAX_TRAIL_LENGTH};
-entityArray Background = {.Capacity = MAX_ARRAY_LENGTH};
-entityArray Pipes = {.Capacity = MAX_PIPES_AMOUNT};
-
-float PipeStartX = 45.0f; 
-float PipeStartY = 10.0f;
-float PipeWidth = 4.0f;
-float PipeHeight = 25.0f;
-float PipeVerticalSpace = 10.0f;
-
-int   PipeSpawnRate = 500; // milliseconds
-int   TrailSpawnRate = 30; // milliseconds
-
-float PipeSpeed = 20.0f;
-float BirdSpeed = 2.0f;
+
+timer FrameTimer;
+uint64_t FrameNanoseconds;
+uint64_t MaxFrameNanoseconds = 250000000; // 0.25 s
+float FrameSeconds;
+stepClock StepClock;
+float Alpha;
+
+// One color per tile, tile X, Y sits at Background[Y * XTiles + X].
+// Bump BackgroundVersion after changing it so the baked mesh follows.
+color *Background;
+int BackgroundVersion;
+backgroundMesh BackgroundMesh;
+
+world World;
+
+// With Pipelined set the simulation runs on its own thread and owns
+// World and StepClock, Draw() shows the newest frame it published.
+// Otherwise Update() runs the steps and Draw() shows World.
+int Pipelined = 1;
+tripleBuffer Frames;
+HANDLE SimulationThread;
+_Atomic int SimulationQuit;
+world *Shown = &World;
+
+// Every step of the session, written out when the game closes so the
+// run can be replayed and verified with headless -replay
+replay Replay;
+char *ReplayPath = "last.replay";
+
 float CameraSpeed = 50.0f;
 
-float BirdWidth = 1.0f;
-float BirdHeight = 1.0f;
+commandList Commands;
 
-mesh MeshPipe;
+// Frame time histogram, toggled with H in PROFILE builds
+int ShowProfileOverlay = 1;
+char *ProfileTracePath = "profile.json";
 
-int RectanglesIntersect(rectangle* A, rectangle* B) {
-    if(A->Left > B->Right) return 0;
-    if(B->Left > A->Right) return 0;
-    if(A->Bottom > B->Top) return 0;
-    if(B->Bottom > A->Top) return 0;
-    return 1;
-}
+// Frame rate of the target FPS pacing mode
+int TargetFramesPerSecond = 120;
 
-void AddEntityToArray(entity* Entity, entityArray* Array) {
-    Array->Entities[Array->Index++] = *Entity;
-    if(Array->Length < Array->Capacity) {
-        ++Array->Length;
-    }
-    if(Array->Index >= Array->Capacity) {
-        Array->Index = 0;
+// Plays the game when on, I toggles it. Flapping yourself still works,
+// the planner starts over from whatever the bird does.
+autopilot Autopilot;
+_Atomic int AutopilotOn;
+int AutopilotHorizon = 120;
+int AutopilotStates = 512;
+
+// Sparks off the bird for every pipe pair it passes. They get their own
+// random numbers, the world's stay for the world.
+particleEffect SparkEffect = {
+    .Acceleration = {0.0f, -0.01f, 0.0f},
+    .Lifetime = 45.0f,
+    .StartColor = {1.0f, 0.8f, 0.2f, 1.0f},
+    .EndColor = {0.2f, 0.2f, 0.2f, 1.0f},
+    .FadeTime = 45.0f,
+    .Size = 0.5f,
+};
+particlePool Sparks;
+random SparkRandom;
+int SparksPerPoint = 64;
+int SparkScore;
+
+// Culling counters go to the debugger output once a second
+int CullReportInterval = 60;
+int CullReportFrame;
+
+// Runs the steps that came due in the Elapsed time up to real time Now.
+// Every step gets the input events up to the real time it stands for,
+// the last step everything handled so far, so nothing waits for the
+// next batch. The profiler only works on the main thread, so the
+// simulation thread runs without zones.
+
+uint64_t RunDueSteps(uint64_t Elapsed, uint64_t Now) {
+
+    int Profile = !Pipelined;
+    uint64_t FirstStep = StepClock.Steps + 1;
+    uint64_t Steps = AdvanceSteps(&StepClock, Elapsed);
+
+    for(uint64_t Step = FirstStep; Step < FirstStep + Steps; ++Step) {
+        uint64_t StepTime = Step + 1 < FirstStep + Steps ?
+                            GetStepRealTime(&StepClock, Step, Now) : Now;
+        input GameInput = ConsumeInput(&InputQueue, StepTime);
+
+        if(AutopilotOn && !World.Pause && !GameInput.TogglePause) {
+            if(Profile) PROFILE_BEGIN("Autopilot");
+            GameInput.Flap |= RunAutopilot(&Autopilot, &World);
+            if(Profile) PROFILE_END();
+        }
+
+        if(Profile) PROFILE_BEGIN("UpdateWorld");
+        UpdateWorld(&World, &GameInput);
+        if(Profile) PROFILE_END();
+        RecordStep(&Replay, &GameInput, &World);
+
+        MarkSimulated(&InputQueue, GetMonotonicNanoseconds());
     }
+
+    return Steps;
 }
 
-void DrawEntity(entity* Entity) {
-    
-    color Color = Entity->Color;
-    
-    if(PracticeMode && Entity->Type == PIPE) {
-        Color = ColorPipePractice;
-        if(Entity->Hit) {
-            Color = ColorPipeHit;
+// Simulation thread. Runs the steps as they come due and publishes a
+// frame after each batch, then sleeps until the next step is due.
+
+DWORD WINAPI SimulationLoop(void *Parameter) {
+
+    timer StepTimer;
+    InitTimer(&StepTimer, &RealClock);
+    StepTimer.Start = FrameTimer.Start;
+    void *SleepTimer = CreateHighResolutionTimer();
+
+    while(!atomic_load(&SimulationQuit)) {
+
+        uint64_t Elapsed = LapTimer(&StepTimer);
+        if(Elapsed > MaxFrameNanoseconds) {
+            Elapsed = MaxFrameNanoseconds;
+        }
+        uint64_t Now = StepTimer.Start;
+
+        if(RunDueSteps(Elapsed, Now)) {
+            frameState *Frame = GetBackFrame(&Frames);
+            Frame->World = World;
+            Frame->Step = InputQueue.Steps;
+            Frame->StepTime = GetStepRealTime(&StepClock, StepClock.Steps, Now);
+            PublishFrame(&Frames);
+        }
+        if(!World.Running) break;
+
+        uint64_t Next = GetStepRealTime(&StepClock, StepClock.Steps + 1, Now);
+        Now = GetMonotonicNanoseconds();
+        if(Next > Now) {
+            WindowsSleep(SleepTimer, Next - Now);
         }
     }
-    
-    DrawOne(Entity->Position, Color, Entity->Mesh);
+
+    if(SleepTimer) CloseHandle(SleepTimer);
+    return 0;
 }
 
 void Draw() {
-    
-    // Background
-    
-    for(int Index = 0; Index < Background.Length; ++Index) {
-        DrawEntity(&Background.Entities[Index]);
+
+    ResetCommands(&Commands);
+
+    Commands.ViewProjection = MultiplyMatrix(&ViewMatrix, &ProjectionMatrix);
+
+    // Background, baked into one mesh
+
+    if(BakeBackground(&BackgroundMesh, Background, XTiles, YTiles, BackgroundVersion) > 0) {
+        if(Meshes[MESH_BACKGROUND].Buffer) {
+            ID3D11Buffer_Release(Meshes[MESH_BACKGROUND].Buffer);
+        }
+        Meshes[MESH_BACKGROUND] = CreateMesh((float*)BackgroundMesh.Vertices,
+                                             BackgroundMesh.VertexCount * sizeof(vertex),
+                                             sizeof(vertex) / sizeof(float), 0);
     }
-    
-    // Pipes
-    
-    for(int Index = 0; Index < Pipes.Length; ++Index) {
-        DrawEntity(&Pipes.Entities[Index]);
+
+    // Only what the camera can see of the Z = 0 plane
+
+    bounds Visible = GetVisibleBounds(&Commands.ViewProjection, 0.0f);
+
+    PushBakedBackground(&Commands, &BackgroundMesh, &Visible);
+    PushWorld(&Commands, Shown, Alpha, &Visible);
+
+    // Sparks spawn at the end of a step, which is drawn at Alpha 1
+    PushParticles(&Commands, &Sparks, (float)Shown->Tick - 1.0f + Alpha, &Visible);
+
+#ifdef PROFILE
+    if(ShowProfileOverlay) {
+        PushProfileOverlay(&Commands, &Profiler, &Visible);
     }
-    
-    // Trail
-    
-    for(int Index = 0; Index < Trail.Length; ++Index) {
-        DrawEntity(&Trail.Entities[Index]);
+#endif
+
+    SubmitCommands(&Commands);
+
+    if(++CullReportFrame >= CullReportInterval) {
+        Debug("submitted %d culled %d draws %d\n",
+              Commands.Submitted, Commands.Culled, Commands.BatchCount);
+        CullReportFrame = 0;
     }
-    
-    DrawEntity(&Bird);
 }
 
 void Init() {
-    
-    InitTimer(&PipeTimer);
-    InitTimer(&TrailTimer);
-    
-    // Bird
-    
-    Bird = (entity){
-        .Position = {20.0f, 40.0f, 0.0f},
-        .Color = ColorBird,
-        .Mesh = MeshRectangle,
-        .Velocity = {0.0f, 0.0f, 0.0f},
-        .MaxVelocity = {0.0f, 10.0f, 0.0f},
-    };
-    
-    // Pipe mesh
-    
-    float PipeVertexData[] = {
-        -PipeWidth / 2.0f, -PipeHeight / 2.0f, 0.0f,
-        -PipeWidth / 2.0f, PipeHeight / 2.0f, 0.0f,
-        PipeWidth / 2.0f, PipeHeight / 2.0f, 0.0f,
-        -PipeWidth / 2.0f, -PipeHeight / 2.0f, 0.0f,
-        PipeWidth / 2.0f, PipeHeight / 2.0f, 0.0f,
-        PipeWidth / 2.0f, -PipeHeight / 2.0f, 0.0f,
-    };
-    
-    MeshPipe = CreateMesh(PipeVertexData, sizeof(PipeVertexData),
-                          3, 0);
-    
-    // Background
-    
-    for(int Y = 0; Y < YTiles; ++Y) {
-        for(int X = 0; X < XTiles; ++X) {
-            entity Entity = {
-                .Position = {X, Y},
-                .Color = ColorBackground,
-                .Mesh = MeshRectangle,
-            };
-            
-            // Some lighter tiles
-            
-            if((rand() % 100) < 3) {
-                Entity.Color = ColorBackgroundLighter;
-            }
-            AddEntityToArray(&Entity, &Background);
+
+    InitTimer(&FrameTimer, &RealClock);
+    StepClock = CreateStepClock(StepsPerSecond);
+    Pacer.TargetInterval = NANOSECONDS_PER_SECOND / TargetFramesPerSecond;
+    SelectKernels();
+
+    unsigned int Seed = (unsigned int)time(NULL);
+    InitWorld(&World, Seed);
+    InitReplay(&Replay, Seed);
+
+    // Background, from a copy of the world's generator jumped ahead so
+    // the tiles do not use up the world's numbers
+
+    random TileRandom = World.Random;
+    JumpRandom(&TileRandom);
+
+    Background = malloc(XTiles * YTiles * sizeof(color));
+    FillBackground(Background, XTiles, YTiles, &TileRandom);
+
+    SparkRandom = TileRandom;
+    JumpRandom(&SparkRandom);
+    if(!CreateParticlePool(&Sparks, 4096, &SparkEffect)) {
+        Debug("could not allocate the sparks\n");
+    }
+
+    if(!InitAutopilot(&Autopilot, AutopilotHorizon, AutopilotStates)) {
+        Debug("could not allocate the autopilot\n");
+    }
+
+    if(Pipelined) {
+        frameState First = {
+            .World = World,
+            .StepTime = FrameTimer.Start,
+            .StepNanoseconds = NANOSECONDS_PER_SECOND / StepsPerSecond,
+        };
+        InitTripleBuffer(&Frames, &First);
+        SimulationThread = CreateThread(0, 0, SimulationLoop, 0, 0, 0);
+        if(!SimulationThread) {
+            Debug("could not start the simulation thread\n");
+            Pipelined = 0;
         }
     }
-    
+}
+
+void Shutdown() {
+    if(Pipelined) {
+        atomic_store(&SimulationQuit, 1);
+        WaitForSingleObject(SimulationThread, INFINITE);
+        CloseHandle(SimulationThread);
+        Debug("frames published %ld, never drawn %ld\n", Frames.Published, GetSkippedFrames(&Frames));
+    }
+
+    if(!WriteReplay(&Replay, ReplayPath)) {
+        Debug("could not write %s\n", ReplayPath);
+    }
+    FreeReplay(&Replay);
+    FreeAutopilot(&Autopilot);
+    FreeParticlePool(&Sparks);
+
+    latencyStats *ToSimulation = &InputQueue.ToSimulation;
+    latencyStats *ToPresent = &InputQueue.ToPresent;
+    Debug("flaps %ld, input to simulation mean %.2f ms p99 %.1f ms, "
+          "input to present mean %.2f ms p99 %.1f ms, dropped events %ld\n",
+          ToSimulation->Count, GetLatencyMean(ToSimulation), GetLatencyPercentile(ToSimulation, 99.0),
+          GetLatencyMean(ToPresent), GetLatencyPercentile(ToPresent, 99.0), InputQueue.Dropped);
+
+#ifdef PROFILE
+    if(!WriteProfileTrace(&Profiler, ProfileTracePath)) {
+        Debug("could not write %s\n", ProfileTracePath);
+    }
+    FreeProfiler(&Profiler);
+#endif
 }
 
 void Input() {
-    
-    if(KeyPressed[P]) {
-        Pause = (Pause ? 0 : 1);
-        KeyPressed[P] = 0;
+
+    // Frame time
+
+    FrameNanoseconds = LapTimer(&FrameTimer);
+    if(FrameNanoseconds > MaxFrameNanoseconds) {
+        FrameNanoseconds = MaxFrameNanoseconds;
     }
-    if(KeyPressed[M]) {
-        PracticeMode = (PracticeMode ? 0 : 1);
-        KeyPressed[M] = 0;
+    FrameSeconds = (float)NanosecondsToSeconds(FrameNanoseconds);
+
+    if(KeyPressed[H]) {
+        ShowProfileOverlay = !ShowProfileOverlay;
+        KeyPressed[H] = 0;
     }
-    
+
+    if(KeyPressed[V]) {
+        SetPacingMode(&Pacer, (Pacer.Mode + 1) % PACING_MODE_COUNT);
+        Debug("pacing: %s\n", PacingModeNames[Pacer.Mode]);
+        KeyPressed[V] = 0;
+    }
+
+    if(KeyPressed[I]) {
+        AutopilotOn = !AutopilotOn && Autopilot.States;
+        Debug("autopilot: %s\n", AutopilotOn ? "on" : "off");
+        KeyPressed[I] = 0;
+    }
+
     // Camera
-    
-    v3 CameraAcceleration = {0};
-    
+
+    v3 CameraDirection = {0};
+
     if(KeyDown[W]) {
-        CameraAcceleration.Y = 1.0f; 
+        CameraDirection.Y = 1.0f;
     }
     if(KeyDown[A]) {
-        CameraAcceleration.X = -1.0f; 
+        CameraDirection.X = -1.0f;
     }
     if(KeyDown[S]) {
-        CameraAcceleration.Y = -1.0f; 
+        CameraDirection.Y = -1.0f;
     }
     if(KeyDown[D]) {
-        CameraAcceleration.X = 1.0f; 
+        CameraDirection.X = 1.0f;
     }
     if(KeyDown[Q]) {
-        CameraAcceleration.Z = -1.0f; 
+        CameraDirection.Z = -1.0f;
     }
     if(KeyDown[E]) {
-        CameraAcceleration.Z = 1.0f; 
+        CameraDirection.Z = 1.0f;
     }
-    
-    v3 CameraVelocity = {0};
-    
-    CameraVelocity = AddV3(CameraVelocity, 
-                           MultiplyV3Scalar(CameraAcceleration, DeltaTime * CameraSpeed));
-    CameraPosition = AddV3(CameraPosition, MultiplyV3Scalar(CameraVelocity, DeltaTime * CameraSpeed));
-    
-    ViewMatrix = (matrix){
-        1.0f, 0.0f, 0.0f, 0.0f,
-        0.0f, 1.0f, 0.0f, 0.0f,
-        0.0f, 0.0f, 1.0f, 0.0f,
-        -CameraPosition.X, -CameraPosition.Y, -CameraPosition.Z, 1.0f,
-    };
-    
+
+    // CameraSpeed units per second in the held direction, so the camera
+    // moves as fast at any frame rate
+
+    v3 CameraVelocity = MultiplyV3Scalar(CameraDirection, CameraSpeed);
+    CameraPosition = AddV3(CameraPosition, MultiplyV3Scalar(CameraVelocity, FrameSeconds));
+
+    ViewMatrix = GetViewMatrix(CameraPosition);
 }
 
+// Runs the steps the frame time allows, or with Pipelined takes the
+// newest frame of the simulation thread. Whatever is left over of a
+// step becomes the blend factor between the last two steps for Draw().
+
 void Update() {
-    
-    if(Pause) return; 
-    
-    // Bird
-    
-    v3 Acceleration = {0.0f, -Gravity, 0.0f};
-    
-    if(KeyDown[SPACE]) { 
-        Acceleration.Y = 4 * Gravity; 
-    }
-    
-    // velocity += acceleration * dt * speed
-    
-    Bird.Velocity = AddV3(Bird.Velocity, 
-                          MultiplyV3Scalar(Acceleration, DeltaTime * BirdSpeed));
-    
-    if(Bird.Velocity.Y >= Bird.MaxVelocity.Y) {
-        Bird.Velocity.Y = Bird.MaxVelocity.Y;
+
+    if(Pipelined) {
+        frameState *Frame = TakeFrame(&Frames);
+        Shown = &Frame->World;
+        ShownStep = Frame->Step;
+        Alpha = GetFrameAlpha(Frame, FrameTimer.Start);
+    } else {
+        RunDueSteps(FrameNanoseconds, FrameTimer.Start);
+        Shown = &World;
+        ShownStep = InputQueue.Steps;
+        Alpha = World.Pause ? 1.0f : GetStepAlpha(&StepClock);
     }
-    
-    // position += velocity * dt * speed
-    
-    Bird.Position = AddV3(Bird.Position, MultiplyV3Scalar(Bird.Velocity, DeltaTime * BirdSpeed));
-    
-    rectangle BirdRectangle = {
-        Bird.Position.X - BirdWidth / 2.0f,
-        Bird.Position.X + BirdWidth / 2.0f,
-        Bird.Position.Y + BirdHeight / 2.0f,
-        Bird.Position.Y - BirdHeight / 2.0f,
-    };
-    
-    // Pipes
-    
-    for(int Index = 0; Index < Pipes.Length; ++Index) {
-        
-        entity* Pipe = &Pipes.Entities[Index];
-        
-        // Check collision with the bird
-        
-        rectangle PipeRectangle = {
-            Pipe->Position.X - PipeWidth / 2.0f,
-            Pipe->Position.X + PipeWidth / 2.0f,
-            Pipe->Position.Y + PipeHeight / 2.0f,
-            Pipe->Position.Y - PipeHeight / 2.0f,
+
+    // Sparks for the pipe pairs passed since the last frame
+
+    for(int Spark = 0; Spark < (Shown->Score - SparkScore) * SparksPerPoint; ++Spark) {
+        v3 Velocity = {
+            RandomZeroToOne(&SparkRandom) * 0.4f - 0.3f,
+            RandomZeroToOne(&SparkRandom) * 0.4f - 0.1f,
+            0.0f,
         };
-        
-        if(RectanglesIntersect(&BirdRectangle, &PipeRectangle)) {
-            
-            if(PracticeMode) {
-                Pipe->Hit = 1;
-            } else {
-                Running = 0;
-            }
-        }
-        
-        // Move pipe
-        
-        Pipe->Position.X -= DeltaTime * PipeSpeed;
-    }
-    
-    // Add trail entity
-    
-    UpdateTimer(&TrailTimer);
-    
-    if(TrailTimer.ElapsedMilliSeconds > TrailSpawnRate) {
-        AddEntityToArray(&(entity){
-                             .Position = Bird.Position,
-                             .Color = ColorTrail,
-                             .Mesh = MeshRectangle,
-                             .Type = TRAIL,
-                         }, &Trail);
-        StartTimer(&TrailTimer);
-    }
-    
-    // Move & color trail entities
-    
-    for(int Index = 0; Index < Trail.Length; ++Index) {
-        entity *Entity = &Trail.Entities[Index];
-        
-        Entity->Position.X -= DeltaTime * PipeSpeed;
-        
-        Entity->Color.R -= (Entity->Color.R > ColorBackground.R) ? 0.005f : 0;
-        Entity->Color.G -= (Entity->Color.G > ColorBackground.G) ? 0.005f : 0;
-        Entity->Color.B -= (Entity->Color.B > ColorBackground.B) ? 0.005f : 0;
+        EmitParticle(&Sparks, (float)Shown->Tick, Shown->Bird.Position, Velocity);
     }
-    
-    // Spawn new pipe pair
-    
-    UpdateTimer(&PipeTimer);
-    
-    if(PipeTimer.ElapsedMilliSeconds > PipeSpawnRate) {
-        float Offset = rand() % 10 - 5;
-        
-        AddEntityToArray(&(entity){
-                             .Position = {
-                                 PipeStartX, 
-                                 PipeStartY + Offset,
-                             },
-                             .Color = ColorPipe,
-                             .Mesh = MeshPipe,
-                             .Type = PIPE,
-                         }, &Pipes);
-        
-        AddEntityToArray(&(entity){
-                             .Position = {
-                                 PipeStartX, 
-                                 PipeStartY + Offset + PipeHeight + PipeVerticalSpace,
-                             },
-                             .Color = ColorPipe,
-                             .Mesh = MeshPipe,
-                             .Type = PIPE,
-                         }, &Pipes);
-        
-        StartTimer(&PipeTimer);
+    SparkScore = Shown->Score;
+
+    if(!Shown->Running) {
+        Running = 0;
     }
-    
 }
-
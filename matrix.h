@@ -0,0 +1,220 @@
+#ifndef MATRIX_H
+#define MATRIX_H
+
+// 4x4 matrices for the renderers. Row vectors, the way shaders.hlsl
+// multiplies them: a point is transformed as P * M and A * B applies A
+// first.
+//
+// A matrix row is 4 floats, one SIMD register. Multiply and the point
+// transforms are written once on top of a few lane functions, which
+// use SSE on x86, NEON on ARM and plain floats everywhere else or with
+// MATRIX_SCALAR defined. The lanes do the same multiplies and adds in
+// the same order as the ...Scalar versions, so all of them give
+// bit-identical results.
+//
+// InvertMatrix() runs once per frame at most and stays scalar. So do
+// the v3 helpers in core.h: they are called a handful of times per step
+// or frame, never over arrays, and a v3 is 12 bytes, so a lane load
+// would read past it and packing one costs more than the 3 adds it
+// saves. The bird and camera updates also have to stay bit-identical
+// for replays, snapshots and coarse stepping.
+
+#include "core.h"
+
+#if !defined(MATRIX_SCALAR) && (defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86))
+
+#include <xmmintrin.h>
+#define MATRIX_LANES "sse"
+
+typedef __m128 lanes;
+
+lanes LoadLanes(float *Values) { return _mm_loadu_ps(Values); }
+void StoreLanes(float *Values, lanes Lanes) { _mm_storeu_ps(Values, Lanes); }
+lanes SplatLanes(float Value) { return _mm_set1_ps(Value); }
+lanes AddLanes(lanes A, lanes B) { return _mm_add_ps(A, B); }
+lanes MultiplyLanes(lanes A, lanes B) { return _mm_mul_ps(A, B); }
+
+#elif !defined(MATRIX_SCALAR) && (defined(__ARM_NEON) || defined(_M_ARM64))
+
+#include <arm_neon.h>
+#define MATRIX_LANES "neon"
+
+typedef float32x4_t lanes;
+
+// Separate multiply and add, vmlaq_f32 may become a fused one
+
+lanes LoadLanes(float *Values) { return vld1q_f32(Values); }
+void StoreLanes(float *Values, lanes Lanes) { vst1q_f32(Values, Lanes); }
+lanes SplatLanes(float Value) { return vdupq_n_f32(Value); }
+lanes AddLanes(lanes A, lanes B) { return vaddq_f32(A, B); }
+lanes MultiplyLanes(lanes A, lanes B) { return vmulq_f32(A, B); }
+
+#else
+
+#define MATRIX_LANES "scalar"
+
+typedef struct { float E[4]; } lanes;
+
+lanes LoadLanes(float *Values) {
+    return (lanes){{Values[0], Values[1], Values[2], Values[3]}};
+}
+
+void StoreLanes(float *Values, lanes Lanes) {
+    memcpy(Values, Lanes.E, sizeof(Lanes.E));
+}
+
+lanes SplatLanes(float Value) {
+    return (lanes){{Value, Value, Value, Value}};
+}
+
+lanes AddLanes(lanes A, lanes B) {
+    return (lanes){{A.E[0] + B.E[0], A.E[1] + B.E[1], A.E[2] + B.E[2], A.E[3] + B.E[3]}};
+}
+
+lanes MultiplyLanes(lanes A, lanes B) {
+    return (lanes){{A.E[0] * B.E[0], A.E[1] * B.E[1], A.E[2] * B.E[2], A.E[3] * B.E[3]}};
+}
+
+#endif
+
+matrix IdentityMatrix() {
+    return (matrix){
+        1.0f, 0.0f, 0.0f, 0.0f,
+        0.0f, 1.0f, 0.0f, 0.0f,
+        0.0f, 0.0f, 1.0f, 0.0f,
+        0.0f, 0.0f, 0.0f, 1.0f,
+    };
+}
+
+// Scalar
+
+matrix MultiplyMatrixScalar(matrix *A, matrix *B) {
+    matrix Result;
+    for(int Row = 0; Row < 4; ++Row) {
+        for(int Column = 0; Column < 4; ++Column) {
+            Result.M[Row][Column] = A->M[Row][0] * B->M[0][Column] +
+                                    A->M[Row][1] * B->M[1][Column] +
+                                    A->M[Row][2] * B->M[2][Column] +
+                                    A->M[Row][3] * B->M[3][Column];
+        }
+    }
+    return Result;
+}
+
+// Out gets the 4 clip space components of Point * Matrix
+
+void TransformPointScalar(matrix *Matrix, v3 Point, float *Out) {
+    for(int Column = 0; Column < 4; ++Column) {
+        Out[Column] = Point.X * Matrix->M[0][Column] +
+                      Point.Y * Matrix->M[1][Column] +
+                      Point.Z * Matrix->M[2][Column] +
+                      Matrix->M[3][Column];
+    }
+}
+
+// Count points Stride bytes apart, each moved by Offset first, the way
+// the vertex shader adds the instance position. Out gets 4 floats per
+// point.
+
+void TransformPointsScalar(matrix *Matrix, v3 Offset, v3 *Points, int Stride, int Count, float *Out) {
+    char *Point = (char *)Points;
+    for(int Index = 0; Index < Count; ++Index) {
+        v3 *Position = (v3 *)(Point + (size_t)Index * Stride);
+        v3 Moved = {Position->X + Offset.X, Position->Y + Offset.Y, Position->Z + Offset.Z};
+        TransformPointScalar(Matrix, Moved, Out + Index * 4);
+    }
+}
+
+// Lanes
+
+matrix MultiplyMatrix(matrix *A, matrix *B) {
+    lanes B0 = LoadLanes(B->M[0]);
+    lanes B1 = LoadLanes(B->M[1]);
+    lanes B2 = LoadLanes(B->M[2]);
+    lanes B3 = LoadLanes(B->M[3]);
+
+    matrix Result;
+    for(int Row = 0; Row < 4; ++Row) {
+        lanes Sum = MultiplyLanes(SplatLanes(A->M[Row][0]), B0);
+        Sum = AddLanes(Sum, MultiplyLanes(SplatLanes(A->M[Row][1]), B1));
+        Sum = AddLanes(Sum, MultiplyLanes(SplatLanes(A->M[Row][2]), B2));
+        Sum = AddLanes(Sum, MultiplyLanes(SplatLanes(A->M[Row][3]), B3));
+        StoreLanes(Result.M[Row], Sum);
+    }
+    return Result;
+}
+
+void TransformPoint(matrix *Matrix, v3 Point, float *Out) {
+    lanes Sum = MultiplyLanes(SplatLanes(Point.X), LoadLanes(Matrix->M[0]));
+    Sum = AddLanes(Sum, MultiplyLanes(SplatLanes(Point.Y), LoadLanes(Matrix->M[1])));
+    Sum = AddLanes(Sum, MultiplyLanes(SplatLanes(Point.Z), LoadLanes(Matrix->M[2])));
+    Sum = AddLanes(Sum, LoadLanes(Matrix->M[3]));
+    StoreLanes(Out, Sum);
+}
+
+void TransformPoints(matrix *Matrix, v3 Offset, v3 *Points, int Stride, int Count, float *Out) {
+    lanes M0 = LoadLanes(Matrix->M[0]);
+    lanes M1 = LoadLanes(Matrix->M[1]);
+    lanes M2 = LoadLanes(Matrix->M[2]);
+    lanes M3 = LoadLanes(Matrix->M[3]);
+
+    char *Point = (char *)Points;
+    for(int Index = 0; Index < Count; ++Index) {
+        v3 *Position = (v3 *)(Point + (size_t)Index * Stride);
+        lanes Sum = MultiplyLanes(SplatLanes(Position->X + Offset.X), M0);
+        Sum = AddLanes(Sum, MultiplyLanes(SplatLanes(Position->Y + Offset.Y), M1));
+        Sum = AddLanes(Sum, MultiplyLanes(SplatLanes(Position->Z + Offset.Z), M2));
+        Sum = AddLanes(Sum, M3);
+        StoreLanes(Out + Index * 4, Sum);
+    }
+}
+
+// General inverse from the 2x2 determinants of the top and bottom two
+// rows. Returns 0 and leaves Result alone if Matrix has none.
+
+int InvertMatrix(matrix *Matrix, matrix *Result) {
+    float (*A)[4] = Matrix->M;
+
+    float S0 = A[0][0] * A[1][1] - A[1][0] * A[0][1];
+    float S1 = A[0][0] * A[1][2] - A[1][0] * A[0][2];
+    float S2 = A[0][0] * A[1][3] - A[1][0] * A[0][3];
+    float S3 = A[0][1] * A[1][2] - A[1][1] * A[0][2];
+    float S4 = A[0][1] * A[1][3] - A[1][1] * A[0][3];
+    float S5 = A[0][2] * A[1][3] - A[1][2] * A[0][3];
+
+    float C5 = A[2][2] * A[3][3] - A[3][2] * A[2][3];
+    float C4 = A[2][1] * A[3][3] - A[3][1] * A[2][3];
+    float C3 = A[2][1] * A[3][2] - A[3][1] * A[2][2];
+    float C2 = A[2][0] * A[3][3] - A[3][0] * A[2][3];
+    float C1 = A[2][0] * A[3][2] - A[3][0] * A[2][2];
+    float C0 = A[2][0] * A[3][1] - A[3][0] * A[2][1];
+
+    float Determinant = S0 * C5 - S1 * C4 + S2 * C3 + S3 * C2 - S4 * C1 + S5 * C0;
+    if(Determinant == 0.0f) return 0;
+    float D = 1.0f / Determinant;
+
+    *Result = (matrix){
+        ( A[1][1] * C5 - A[1][2] * C4 + A[1][3] * C3) * D,
+        (-A[0][1] * C5 + A[0][2] * C4 - A[0][3] * C3) * D,
+        ( A[3][1] * S5 - A[3][2] * S4 + A[3][3] * S3) * D,
+        (-A[2][1] * S5 + A[2][2] * S4 - A[2][3] * S3) * D,
+
+        (-A[1][0] * C5 + A[1][2] * C2 - A[1][3] * C1) * D,
+        ( A[0][0] * C5 - A[0][2] * C2 + A[0][3] * C1) * D,
+        (-A[3][0] * S5 + A[3][2] * S2 - A[3][3] * S1) * D,
+        ( A[2][0] * S5 - A[2][2] * S2 + A[2][3] * S1) * D,
+
+        ( A[1][0] * C4 - A[1][1] * C2 + A[1][3] * C0) * D,
+        (-A[0][0] * C4 + A[0][1] * C2 - A[0][3] * C0) * D,
+        ( A[3][0] * S4 - A[3][1] * S2 + A[3][3] * S0) * D,
+        (-A[2][0] * S4 + A[2][1] * S2 - A[2][3] * S0) * D,
+
+        (-A[1][0] * C3 + A[1][1] * C1 - A[1][2] * C0) * D,
+        ( A[0][0] * C3 - A[0][1] * C1 + A[0][2] * C0) * D,
+        (-A[3][0] * S3 + A[3][1] * S1 - A[3][2] * S0) * D,
+        ( A[2][0] * S3 - A[2][1] * S1 + A[2][2] * S0) * D,
+    };
+    return 1;
+}
+
+#endif
@@ -0,0 +1,152 @@
+#ifndef PACING_H
+#define PACING_H
+
+// Frame pacing. Decides when a frame starts and how it is presented:
+//
+// - vsync: present waits for the next vertical blank, one frame queued
+// - uncapped: present right away, as many frames as the CPU can make
+// - target FPS: present right away, but start frames at a fixed rate,
+//   sleeping most of the wait and spinning the last bit
+// - just in time: like vsync, but the frame starts as late as possible
+//   before the vertical blank, so input is read as late as possible.
+//   The start is the expected vblank minus the recent work time minus a
+//   safety margin.
+//
+// Time comes from a gameClock, and waiting goes through the platform
+// hooks in pacingPlatform. On a virtual clock with hooks that advance
+// it, the scheduling runs without a display or a real clock.
+
+#include <stdint.h>
+
+#include "clock.h"
+
+enum {
+    PACING_VSYNC,
+    PACING_UNCAPPED,
+    PACING_TARGET_FPS,
+    PACING_JUST_IN_TIME,
+    PACING_MODE_COUNT,
+};
+
+char *PacingModeNames[PACING_MODE_COUNT] = {"vsync", "uncapped", "target fps", "just in time"};
+
+typedef struct {
+    // Sleep for about Nanoseconds, allowed to oversleep
+    void (*Sleep)(void *Context, uint64_t Nanoseconds);
+    // Called over and over while spinning the last part of a wait
+    void (*Spin)(void *Context);
+    void *Context;
+} pacingPlatform;
+
+typedef struct {
+    int Mode;
+    gameClock *Clock;
+    pacingPlatform Platform;
+
+    uint64_t RefreshInterval;   // of the display
+    uint64_t TargetInterval;    // target FPS mode
+    uint64_t SpinThreshold;     // waits shorter than this spin instead of sleeping
+    uint64_t SafetyMargin;      // just in time mode
+
+    uint64_t NextFrame;         // target FPS mode, when the next frame starts
+    uint64_t LastVBlank;        // last known vertical blank
+    uint64_t FrameStart;        // when the current frame's work started
+    uint64_t WorkEstimate;      // recent work time, rises at once and decays slowly
+
+    long Frames;
+    uint64_t Slept;
+    uint64_t Spun;
+} pacer;
+
+void InitPacer(pacer *Pacer, int Mode, gameClock *Clock, pacingPlatform Platform, uint64_t RefreshInterval) {
+    *Pacer = (pacer){
+        .Mode = Mode,
+        .Clock = Clock,
+        .Platform = Platform,
+        .RefreshInterval = RefreshInterval,
+        .TargetInterval = RefreshInterval,
+        .SpinThreshold = 2000000,
+        .SafetyMargin = 2000000,
+        .WorkEstimate = RefreshInterval / 2,
+    };
+}
+
+void SetPacingMode(pacer *Pacer, int Mode) {
+    Pacer->Mode = Mode;
+    Pacer->NextFrame = 0;
+    Pacer->LastVBlank = 0;
+}
+
+// Sleeps until SpinThreshold before Deadline, then spins up to it
+
+void WaitUntil(pacer *Pacer, uint64_t Deadline) {
+    uint64_t Now = ReadClock(Pacer->Clock);
+
+    if(Now + Pacer->SpinThreshold < Deadline) {
+        Pacer->Platform.Sleep(Pacer->Platform.Context, Deadline - Pacer->SpinThreshold - Now);
+        uint64_t Woke = ReadClock(Pacer->Clock);
+        Pacer->Slept += Woke - Now;
+        Now = Woke;
+    }
+
+    uint64_t SpinStart = Now;
+    while(Now < Deadline) {
+        Pacer->Platform.Spin(Pacer->Platform.Context);
+        Now = ReadClock(Pacer->Clock);
+    }
+    Pacer->Spun += Now - SpinStart;
+}
+
+// Call before reading input. Waits until the frame should start.
+
+void BeginFrame(pacer *Pacer) {
+
+    uint64_t Now = ReadClock(Pacer->Clock);
+
+    if(Pacer->Mode == PACING_TARGET_FPS) {
+        // Fell more than a frame behind, start counting from now
+        if(!Pacer->NextFrame || Now > Pacer->NextFrame + Pacer->TargetInterval) {
+            Pacer->NextFrame = Now;
+        }
+        WaitUntil(Pacer, Pacer->NextFrame);
+        Pacer->NextFrame += Pacer->TargetInterval;
+    }
+
+    if(Pacer->Mode == PACING_JUST_IN_TIME && Pacer->LastVBlank) {
+        uint64_t Lead = Pacer->WorkEstimate + Pacer->SafetyMargin;
+        uint64_t NextVBlank = Pacer->LastVBlank + Pacer->RefreshInterval;
+        while(NextVBlank <= Now) {
+            NextVBlank += Pacer->RefreshInterval;
+        }
+        if(Lead < NextVBlank - Now) {
+            WaitUntil(Pacer, NextVBlank - Lead);
+        }
+    }
+
+    Pacer->FrameStart = ReadClock(Pacer->Clock);
+}
+
+// Sync interval to pass to present
+int GetPresentInterval(pacer *Pacer) {
+    return (Pacer->Mode == PACING_VSYNC || Pacer->Mode == PACING_JUST_IN_TIME) ? 1 : 0;
+}
+
+// Call right before present. Feeds the work estimate of just in time
+// mode.
+
+void EndFrameWork(pacer *Pacer) {
+    uint64_t Work = ReadClock(Pacer->Clock) - Pacer->FrameStart;
+    uint64_t Decayed = Pacer->WorkEstimate - Pacer->WorkEstimate / 16;
+    Pacer->WorkEstimate = Work > Decayed ? Work : Decayed;
+    ++Pacer->Frames;
+}
+
+// Call when the platform learns that a vertical blank just happened,
+// such as when a vsync present returns or the swap chain hands back a
+// buffer
+
+void MarkVBlank(pacer *Pacer, uint64_t Time) {
+    Pacer->LastVBlank = Time;
+}
+
+#endif
@@ -0,0 +1,109 @@
+#ifndef PARTICLES_H
+#define PARTICLES_H
+
+// Particles that are never updated. A particle only stores when and
+// where it was spawned and how fast it was going. Where it is and what
+// color it has follow from its age, worked out when it gets drawn:
+//
+//     Position = Spawn + Velocity * Age + Acceleration * Age^2 / 2
+//     Color    = StartColor to EndColor over FadeTime, then EndColor
+//
+// So a step costs nothing however many particles there are, and
+// drawing them is one pass over a few arrays. Time is counted in steps,
+// fractional in between two of them, so particles blend with the world
+// the same way everything else does and stand still while it is
+// paused.
+//
+// A pool holds one kind of particle, the effect, in Capacity slots
+// allocated once. Once it is full the oldest particle makes room for
+// the next one, and particles older than the effect's Lifetime are not
+// drawn.
+
+#include "core.h"
+
+typedef struct {
+    v3 Acceleration;   // units per step^2
+    float Lifetime;    // steps
+    color StartColor;
+    color EndColor;
+    float FadeTime;    // steps
+    float Size;        // half width and height, for culling
+} particleEffect;
+
+typedef struct {
+    particleEffect Effect;
+
+    int Capacity;
+    int Count;
+    int Next;
+
+    float *SpawnTime;
+    float *X;
+    float *Y;
+    float *VelocityX;
+    float *VelocityY;
+
+    void *Memory;
+} particlePool;
+
+int CreateParticlePool(particlePool *Pool, int Capacity, particleEffect *Effect) {
+    memset(Pool, 0, sizeof(*Pool));
+    Pool->Effect = *Effect;
+    Pool->Memory = malloc(5 * Capacity * sizeof(float));
+    if(!Pool->Memory) return 0;
+
+    float *Floats = Pool->Memory;
+    Pool->SpawnTime = Floats;
+    Pool->X = Floats + Capacity;
+    Pool->Y = Floats + 2 * Capacity;
+    Pool->VelocityX = Floats + 3 * Capacity;
+    Pool->VelocityY = Floats + 4 * Capacity;
+    Pool->Capacity = Capacity;
+    return 1;
+}
+
+void FreeParticlePool(particlePool *Pool) {
+    free(Pool->Memory);
+    memset(Pool, 0, sizeof(*Pool));
+}
+
+void ClearParticles(particlePool *Pool) {
+    Pool->Count = 0;
+    Pool->Next = 0;
+}
+
+void EmitParticle(particlePool *Pool, float Time, v3 Position, v3 Velocity) {
+    if(!Pool->Capacity) return;
+
+    int Slot = Pool->Next;
+    Pool->SpawnTime[Slot] = Time;
+    Pool->X[Slot] = Position.X;
+    Pool->Y[Slot] = Position.Y;
+    Pool->VelocityX[Slot] = Velocity.X;
+    Pool->VelocityY[Slot] = Velocity.Y;
+
+    if(++Pool->Next >= Pool->Capacity) Pool->Next = 0;
+    if(Pool->Count < Pool->Capacity) ++Pool->Count;
+}
+
+// Fraction of the fade per step
+float GetFadeRate(particleEffect *Effect) {
+    return Effect->FadeTime > 0.0f ? 1.0f / Effect->FadeTime : 1e30f;
+}
+
+color GetParticleColor(particleEffect *Effect, float Age) {
+    float T = Age * GetFadeRate(Effect);
+    T = T < 0.0f ? 0.0f : T;
+    T = T > 1.0f ? 1.0f : T;
+
+    color *Start = &Effect->StartColor;
+    color *End = &Effect->EndColor;
+    return (color){
+        Start->R + (End->R - Start->R) * T,
+        Start->G + (End->G - Start->G) * T,
+        Start->B + (End->B - Start->B) * T,
+        Start->A + (End->A - Start->A) * T,
+    };
+}
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+// Simulation and rendering on two threads. The simulation thread runs
+// the fixed steps as they come due and publishes a frame after each
+// batch of them. The render thread draws whatever frame is newest, so
+// neither waits for the other:
+//
+//     window procedure --events--> simulation --frames--> renderer
+//
+// Events go through the inputQueue's ring, frames through a triple
+// buffer. One slot is being written, one is being drawn and the third
+// holds the newest finished frame. Publishing swaps the written slot
+// with the third one, taking a frame swaps the drawn slot with it. Both
+// are a single atomic exchange, and a frame the renderer did not get to
+// in time is simply overwritten.
+//
+// A published frame is never touched again until the renderer hands it
+// back, so the renderer reads it without locks. It holds a copy of the
+// world, a few hundred bytes.
+
+#include <stdatomic.h>
+#include <stdint.h>
+
+#include "game.h"
+#include "clock.h"
+
+#define FRAME_FRESH 4 // set in Middle while the renderer has not taken it
+
+typedef struct {
+    world World;
+    uint64_t Step;     // steps run, what MarkPresentedThrough() takes
+    uint64_t StepTime; // real time the last step was due
+    uint64_t StepNanoseconds;
+} frameState;
+
+typedef struct {
+    frameState Frames[3];
+    _Alignas(64) _Atomic uint32_t Middle; // slot, maybe with FRAME_FRESH
+    _Alignas(64) uint32_t Back;           // simulation only
+    long Published;
+    _Alignas(64) uint32_t Front;          // renderer only
+    long Taken;
+} tripleBuffer;
+
+void InitTripleBuffer(tripleBuffer *Buffer, frameState *First) {
+    memset(Buffer, 0, sizeof(*Buffer));
+    for(int Slot = 0; Slot < 3; ++Slot) {
+        Buffer->Frames[Slot] = *First;
+    }
+    Buffer->Back = 0;
+    Buffer->Front = 1;
+    atomic_init(&Buffer->Middle, 2);
+}
+
+// Where the simulation writes the next frame
+frameState *GetBackFrame(tripleBuffer *Buffer) {
+    return &Buffer->Frames[Buffer->Back];
+}
+
+void PublishFrame(tripleBuffer *Buffer) {
+    uint32_t Old = atomic_exchange_explicit(&Buffer->Middle, Buffer->Back | FRAME_FRESH, memory_order_acq_rel);
+    Buffer->Back = Old & 3;
+    ++Buffer->Published;
+}
+
+// The newest frame. Stays valid until the next call.
+frameState *TakeFrame(tripleBuffer *Buffer) {
+    if(atomic_load_explicit(&Buffer->Middle, memory_order_relaxed) & FRAME_FRESH) {
+        uint32_t Old = atomic_exchange_explicit(&Buffer->Middle, Buffer->Front, memory_order_acq_rel);
+        Buffer->Front = Old & 3;
+        ++Buffer->Taken;
+    }
+    return &Buffer->Frames[Buffer->Front];
+}
+
+// Frames published but never drawn, once both threads are done
+long GetSkippedFrames(tripleBuffer *Buffer) {
+    return Buffer->Published - Buffer->Taken;
+}
+
+// Blend factor for drawing Frame at real time Now, how far the next
+// step would be. Like GetStepAlpha() but from the frame's own clock.
+
+float GetFrameAlpha(frameState *Frame, uint64_t Now) {
+    if(Frame->World.Pause || !Frame->StepNanoseconds) return 1.0f;
+    if(Now <= Frame->StepTime) return 0.0f;
+    uint64_t Since = Now - Frame->StepTime;
+    if(Since >= Frame->StepNanoseconds) return 1.0f;
+    return (float)((double)Since / Frame->StepNanoseconds);
+}
+
+#endif
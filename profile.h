@@ -0,0 +1,232 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+// Frame profiler. Zones are begin/end pairs around phases of a frame
+// and counters are single values such as the draw count. Both are kept
+// in a ring of the most recent PROFILE_MAX_EVENTS events. That ring can
+// be written out as Chrome trace JSON (chrome://tracing, Perfetto).
+// Frame times also go into a rolling history that the overlay shows as a
+// histogram.
+//
+// The PROFILE_* macros compile to nothing unless PROFILE is defined.
+// Zones nest but are not thread safe, use them on the main thread only.
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "render.h"
+#include "clock.h"
+
+#define PROFILE_MAX_EVENTS 65536
+#define PROFILE_MAX_DEPTH 16
+#define PROFILE_HISTORY 240
+#define PROFILE_BUCKETS 16
+
+enum {
+    PROFILE_ZONE,
+    PROFILE_COUNTER,
+};
+
+typedef struct {
+    char *Name;
+    int Kind;
+    int Depth;
+    uint64_t Start;     // ns since the profiler started
+    uint64_t Duration;  // ns, zones only
+    int64_t Value;      // counters only
+} profileEvent;
+
+typedef struct {
+    uint64_t Origin;
+
+    profileEvent *Events;
+    uint64_t EventCount; // all ever recorded, Events holds the last ones
+
+    uint64_t Open[PROFILE_MAX_DEPTH];
+    int Depth;
+
+    uint64_t FrameStart;
+    float FrameMilliSeconds[PROFILE_HISTORY];
+    int FrameIndex;
+    int FrameCount;
+} profiler;
+
+// Width of one histogram bucket, the last bucket takes everything above
+float ProfileBucketMilliSeconds = 2.5f;
+
+profiler Profiler;
+
+#ifdef PROFILE
+#define PROFILE_BEGIN(Name) BeginZone(&Profiler, Name)
+#define PROFILE_END() EndZone(&Profiler)
+#define PROFILE_COUNT(Name, Value) CountValue(&Profiler, Name, Value)
+#define PROFILE_FRAME() EndProfileFrame(&Profiler)
+#else
+#define PROFILE_BEGIN(Name) ((void)0)
+#define PROFILE_END() ((void)0)
+#define PROFILE_COUNT(Name, Value) ((void)0)
+#define PROFILE_FRAME() ((void)0)
+#endif
+
+int InitProfiler(profiler *Profiler) {
+    memset(Profiler, 0, sizeof(*Profiler));
+    Profiler->Events = malloc(PROFILE_MAX_EVENTS * sizeof(profileEvent));
+    Profiler->Origin = GetMonotonicNanoseconds();
+    Profiler->FrameStart = Profiler->Origin;
+    return Profiler->Events != 0;
+}
+
+void FreeProfiler(profiler *Profiler) {
+    free(Profiler->Events);
+    Profiler->Events = 0;
+}
+
+profileEvent *AddProfileEvent(profiler *Profiler) {
+    return &Profiler->Events[Profiler->EventCount++ % PROFILE_MAX_EVENTS];
+}
+
+void BeginZone(profiler *Profiler, char *Name) {
+    if(!Profiler->Events) return;
+
+    if(Profiler->Depth < PROFILE_MAX_DEPTH) {
+        Profiler->Open[Profiler->Depth] = Profiler->EventCount;
+    }
+
+    profileEvent *Event = AddProfileEvent(Profiler);
+    *Event = (profileEvent){
+        .Name = Name,
+        .Kind = PROFILE_ZONE,
+        .Depth = Profiler->Depth++,
+        .Start = GetMonotonicNanoseconds() - Profiler->Origin,
+    };
+}
+
+void EndZone(profiler *Profiler) {
+    if(!Profiler->Events || Profiler->Depth <= 0) return;
+
+    uint64_t Now = GetMonotonicNanoseconds() - Profiler->Origin;
+
+    if(--Profiler->Depth >= PROFILE_MAX_DEPTH) return;
+
+    // The zone may have been pushed out of the ring by its children
+    uint64_t Open = Profiler->Open[Profiler->Depth];
+    if(Profiler->EventCount - Open > PROFILE_MAX_EVENTS) return;
+
+    profileEvent *Event = &Profiler->Events[Open % PROFILE_MAX_EVENTS];
+    Event->Duration = Now - Event->Start;
+}
+
+void CountValue(profiler *Profiler, char *Name, int64_t Value) {
+    if(!Profiler->Events) return;
+
+    profileEvent *Event = AddProfileEvent(Profiler);
+    *Event = (profileEvent){
+        .Name = Name,
+        .Kind = PROFILE_COUNTER,
+        .Depth = Profiler->Depth,
+        .Start = GetMonotonicNanoseconds() - Profiler->Origin,
+        .Value = Value,
+    };
+}
+
+// Call once per frame, after Present. Closes the frame zone and starts
+// the next one.
+
+void EndProfileFrame(profiler *Profiler) {
+    if(!Profiler->Events) return;
+
+    uint64_t Now = GetMonotonicNanoseconds() - Profiler->Origin;
+    uint64_t Start = Profiler->FrameStart - Profiler->Origin;
+
+    profileEvent *Event = AddProfileEvent(Profiler);
+    *Event = (profileEvent){
+        .Name = "Frame",
+        .Kind = PROFILE_ZONE,
+        .Start = Start,
+        .Duration = Now - Start,
+    };
+
+    Profiler->FrameMilliSeconds[Profiler->FrameIndex] = (float)((Now - Start) / 1e6);
+    Profiler->FrameIndex = (Profiler->FrameIndex + 1) % PROFILE_HISTORY;
+    if(Profiler->FrameCount < PROFILE_HISTORY) {
+        ++Profiler->FrameCount;
+    }
+
+    Profiler->FrameStart = Now + Profiler->Origin;
+}
+
+// Counts the frames of the history per bucket, returns the largest count
+
+int GetFrameHistogram(profiler *Profiler, int *Buckets) {
+    memset(Buckets, 0, PROFILE_BUCKETS * sizeof(int));
+
+    int Largest = 0;
+    for(int Index = 0; Index < Profiler->FrameCount; ++Index) {
+        int Bucket = (int)(Profiler->FrameMilliSeconds[Index] / ProfileBucketMilliSeconds);
+        if(Bucket >= PROFILE_BUCKETS) Bucket = PROFILE_BUCKETS - 1;
+        if(++Buckets[Bucket] > Largest) Largest = Buckets[Bucket];
+    }
+    return Largest;
+}
+
+// Histogram of the frame times in the lower left corner of Visible, one
+// column per bucket, stacked out of unit rectangles. Buckets that still
+// fit in 60 Hz are green, 30 Hz yellow, the rest red.
+
+void PushProfileOverlay(commandList *Commands, profiler *Profiler, bounds *Visible) {
+
+    int Buckets[PROFILE_BUCKETS];
+    int Largest = GetFrameHistogram(Profiler, Buckets);
+    if(!Largest) return;
+
+    int MaxCells = 10;
+    float Left = Visible->MinX + 1.5f;
+    float Bottom = Visible->MinY + 1.5f;
+
+    color Fast = {0.1f, 0.9f, 0.3f, 1.0f};
+    color Slow = {0.9f, 0.8f, 0.1f, 1.0f};
+    color Late = {0.9f, 0.2f, 0.1f, 1.0f};
+
+    for(int Bucket = 0; Bucket < PROFILE_BUCKETS; ++Bucket) {
+        float MilliSeconds = Bucket * ProfileBucketMilliSeconds;
+        color Color = MilliSeconds < 1000.0f / 60.0f ? Fast : (MilliSeconds < 1000.0f / 30.0f ? Slow : Late);
+
+        // Any non-empty bucket gets at least one cell
+        int Cells = (Buckets[Bucket] * MaxCells + Largest - 1) / Largest;
+        for(int Cell = 0; Cell < Cells; ++Cell) {
+            PushInstance(Commands, MESH_RECTANGLE, (v3){Left + Bucket, Bottom + Cell, 0.0f}, Color);
+        }
+    }
+}
+
+// Chrome trace event format, times in microseconds
+
+int WriteProfileTrace(profiler *Profiler, char *Path) {
+    if(!Profiler->Events) return 0;
+
+    FILE *File = fopen(Path, "w");
+    if(!File) return 0;
+
+    uint64_t First = 0;
+    if(Profiler->EventCount > PROFILE_MAX_EVENTS) {
+        First = Profiler->EventCount - PROFILE_MAX_EVENTS;
+    }
+
+    fprintf(File, "{\"traceEvents\":[\n");
+    for(uint64_t Index = First; Index < Profiler->EventCount; ++Index) {
+        profileEvent *Event = &Profiler->Events[Index % PROFILE_MAX_EVENTS];
+        char *Separator = Index + 1 < Profiler->EventCount ? "," : "";
+        if(Event->Kind == PROFILE_ZONE) {
+            fprintf(File, "{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":1}%s\n",
+                    Event->Name, Event->Start / 1e3, Event->Duration / 1e3, Separator);
+        } else {
+            fprintf(File, "{\"name\":\"%s\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,\"tid\":1,\"args\":{\"value\":%lld}}%s\n",
+                    Event->Name, Event->Start / 1e3, (long long)Event->Value, Separator);
+        }
+    }
+    fprintf(File, "],\"displayTimeUnit\":\"ms\"}\n");
+
+    return fclose(File) == 0;
+}
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef RANDOM_H
+#define RANDOM_H
+
+// xoshiro128** random numbers. Worlds carry their own generator
+// instead of sharing rand(). The sequences only depend on the seed and
+// come out the same with every compiler, C library and platform.
+//
+// SplitRandom() hands out independent streams. The child starts where
+// the parent is, and the parent jumps 2^64 steps ahead, so streams never
+// overlap in practice.
+
+#include <stdint.h>
+#include <string.h>
+
+typedef struct {
+    uint32_t State[4];
+} random;
+
+// splitmix64, spreads any seed over the whole state
+uint64_t SplitMix64(uint64_t *Seed) {
+    uint64_t Z = (*Seed += 0x9E3779B97F4A7C15ull);
+    Z = (Z ^ (Z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    Z = (Z ^ (Z >> 27)) * 0x94D049BB133111EBull;
+    return Z ^ (Z >> 31);
+}
+
+void SeedRandom(random *Random, uint64_t Seed) {
+    uint64_t A = SplitMix64(&Seed);
+    uint64_t B = SplitMix64(&Seed);
+    Random->State[0] = (uint32_t)A;
+    Random->State[1] = (uint32_t)(A >> 32);
+    Random->State[2] = (uint32_t)B;
+    Random->State[3] = (uint32_t)(B >> 32);
+}
+
+uint32_t RotateLeft32(uint32_t Value, int Count) {
+    return (Value << Count) | (Value >> (32 - Count));
+}
+
+uint32_t NextRandom(random *Random) {
+    uint32_t *S = Random->State;
+    uint32_t Result = RotateLeft32(S[1] * 5, 7) * 9;
+    uint32_t T = S[1] << 9;
+
+    S[2] ^= S[0];
+    S[3] ^= S[1];
+    S[1] ^= S[2];
+    S[0] ^= S[3];
+    S[2] ^= T;
+    S[3] = RotateLeft32(S[3], 11);
+
+    return Result;
+}
+
+// Same as calling NextRandom() 2^64 times
+void JumpRandom(random *Random) {
+    static const uint32_t Jump[] = {0x8764000B, 0xF542D2D3, 0x6FA035C3, 0x77F2DB5B};
+
+    uint32_t S[4] = {0};
+    for(int Word = 0; Word < 4; ++Word) {
+        for(int Bit = 0; Bit < 32; ++Bit) {
+            if(Jump[Word] & (1u << Bit)) {
+                S[0] ^= Random->State[0];
+                S[1] ^= Random->State[1];
+                S[2] ^= Random->State[2];
+                S[3] ^= Random->State[3];
+            }
+            NextRandom(Random);
+        }
+    }
+    memcpy(Random->State, S, sizeof(S));
+}
+
+random SplitRandom(random *Parent) {
+    random Child = *Parent;
+    JumpRandom(Parent);
+    return Child;
+}
+
+// 0 <= Result < Range, by multiplying instead of %, so no division
+uint32_t RandomBelow(random *Random, uint32_t Range) {
+    return (uint32_t)(((uint64_t)NextRandom(Random) * Range) >> 32);
+}
+
+// 0 <= Result < 1
+float RandomZeroToOne(random *Random) {
+    return (NextRandom(Random) >> 8) * (1.0f / 16777216.0f);
+}
+
+#endif
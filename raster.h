@@ -0,0 +1,483 @@
+#ifndef RASTER_H
+#define RASTER_H
+
+// Software backend for the command lists from render.h. It does what
+// vs_main/ps_main in shaders.hlsl do: every vertex goes through
+// (position + instance position) * viewProjection and each triangle
+// gets the vertex color times the instance color. The result is
+// written into an RGBA framebuffer in memory.
+//
+// Triangles are set up once, then the screen is split into tiles that
+// are filled in parallel on a job pool. Each tile walks the triangles in
+// submission order, so the result does not depend on the thread count.
+//
+// All meshes here have one color per triangle, so colors are flat
+// instead of interpolated. Triangles with a vertex behind the near
+// plane are dropped instead of clipped; the game's camera never
+// gets that close.
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "render.h"
+#include "jobs.h"
+
+typedef struct {
+    int Width;
+    int Height;
+    uint8_t *Pixels; // RGBA, top row first
+} framebuffer;
+
+typedef struct {
+    float X[3];
+    float Y[3];
+    uint32_t Color;
+    int MinX;
+    int MinY;
+    int MaxX;
+    int MaxY;
+} rasterTriangle;
+
+typedef struct {
+    framebuffer Target;
+    color ClearColor;
+
+    rasterTriangle *Triangles;
+    int TriangleCount;
+    int TriangleCapacity;
+
+    // Clip space vertices of the instance being set up, 4 floats each
+    float *Clip;
+    int ClipCapacity;
+
+    jobPool *Pool; // 0 runs everything on the calling thread
+    int TileSize;
+    int XTiles;
+    int YTiles;
+
+    float Near;
+} rasterizer;
+
+int CreateFramebuffer(framebuffer *Framebuffer, int Width, int Height) {
+    Framebuffer->Width = Width;
+    Framebuffer->Height = Height;
+    Framebuffer->Pixels = malloc((size_t)Width * Height * 4);
+    return Framebuffer->Pixels != 0;
+}
+
+void FreeFramebuffer(framebuffer *Framebuffer) {
+    free(Framebuffer->Pixels);
+    Framebuffer->Pixels = 0;
+}
+
+int CreateRasterizer(rasterizer *Rasterizer, int Width, int Height, jobPool *Pool) {
+    memset(Rasterizer, 0, sizeof(*Rasterizer));
+    if(!CreateFramebuffer(&Rasterizer->Target, Width, Height)) return 0;
+    Rasterizer->ClearColor = (color){0.3f, 0.3f, 0.3f, 1.0f};
+    Rasterizer->Pool = Pool;
+    Rasterizer->TileSize = 64;
+    Rasterizer->XTiles = (Width + Rasterizer->TileSize - 1) / Rasterizer->TileSize;
+    Rasterizer->YTiles = (Height + Rasterizer->TileSize - 1) / Rasterizer->TileSize;
+    Rasterizer->Near = 1.0f;
+    return 1;
+}
+
+void FreeRasterizer(rasterizer *Rasterizer) {
+    FreeFramebuffer(&Rasterizer->Target);
+    free(Rasterizer->Triangles);
+    free(Rasterizer->Clip);
+    Rasterizer->Triangles = 0;
+    Rasterizer->Clip = 0;
+}
+
+uint8_t ColorChannelToByte(float Value) {
+    if(Value <= 0.0f) return 0;
+    if(Value >= 1.0f) return 255;
+    return (uint8_t)(Value * 255.0f + 0.5f);
+}
+
+uint32_t PackColor(color Color) {
+    return (uint32_t)ColorChannelToByte(Color.R) |
+           (uint32_t)ColorChannelToByte(Color.G) << 8 |
+           (uint32_t)ColorChannelToByte(Color.B) << 16 |
+           (uint32_t)ColorChannelToByte(Color.A) << 24;
+}
+
+void AddTriangle(rasterizer *Rasterizer, float *Clip, uint32_t Color) {
+
+    framebuffer *Target = &Rasterizer->Target;
+    rasterTriangle Triangle = {.Color = Color};
+
+    float MinX = 1e30f, MinY = 1e30f, MaxX = -1e30f, MaxY = -1e30f;
+
+    for(int Index = 0; Index < 3; ++Index) {
+        float *Vertex = Clip + Index * 4;
+        if(Vertex[3] < Rasterizer->Near) return;
+
+        float X = (Vertex[0] / Vertex[3] + 1.0f) * 0.5f * Target->Width;
+        float Y = (1.0f - Vertex[1] / Vertex[3]) * 0.5f * Target->Height;
+        Triangle.X[Index] = X;
+        Triangle.Y[Index] = Y;
+
+        if(X < MinX) MinX = X;
+        if(X > MaxX) MaxX = X;
+        if(Y < MinY) MinY = Y;
+        if(Y > MaxY) MaxY = Y;
+    }
+
+    // Pixel centers sit at +0.5, only pixels whose center can be inside
+
+    Triangle.MinX = (int)(MinX - 0.5f);
+    Triangle.MinY = (int)(MinY - 0.5f);
+    Triangle.MaxX = (int)(MaxX + 0.5f);
+    Triangle.MaxY = (int)(MaxY + 0.5f);
+
+    if(Triangle.MinX < 0) Triangle.MinX = 0;
+    if(Triangle.MinY < 0) Triangle.MinY = 0;
+    if(Triangle.MaxX > Target->Width - 1) Triangle.MaxX = Target->Width - 1;
+    if(Triangle.MaxY > Target->Height - 1) Triangle.MaxY = Target->Height - 1;
+
+    if(Triangle.MinX > Triangle.MaxX || Triangle.MinY > Triangle.MaxY) return;
+
+    // Make every triangle counter clockwise on screen (Y points down),
+    // the edge functions in FillTile() are then positive inside
+
+    float Area = (Triangle.X[1] - Triangle.X[0]) * (Triangle.Y[2] - Triangle.Y[0]) -
+                 (Triangle.Y[1] - Triangle.Y[0]) * (Triangle.X[2] - Triangle.X[0]);
+    if(Area == 0.0f) return;
+    if(Area > 0.0f) {
+        float X = Triangle.X[1]; Triangle.X[1] = Triangle.X[2]; Triangle.X[2] = X;
+        float Y = Triangle.Y[1]; Triangle.Y[1] = Triangle.Y[2]; Triangle.Y[2] = Y;
+    }
+
+    if(Rasterizer->TriangleCount >= Rasterizer->TriangleCapacity) {
+        int Capacity = Rasterizer->TriangleCapacity ? Rasterizer->TriangleCapacity * 2 : 4096;
+        rasterTriangle *Triangles = realloc(Rasterizer->Triangles, Capacity * sizeof(rasterTriangle));
+        if(!Triangles) return;
+        Rasterizer->Triangles = Triangles;
+        Rasterizer->TriangleCapacity = Capacity;
+    }
+
+    Rasterizer->Triangles[Rasterizer->TriangleCount++] = Triangle;
+}
+
+// Vertex stage: turns every instance of every batch into screen space
+// triangles. The vertices of an instance are transformed in one go,
+// then taken three at a time.
+
+void SetupTriangles(rasterizer *Rasterizer, commandList *Commands, backgroundMesh *Background) {
+
+    Rasterizer->TriangleCount = 0;
+
+    matrix *ViewProjection = &Commands->ViewProjection;
+
+    for(int BatchIndex = 0; BatchIndex < Commands->BatchCount; ++BatchIndex) {
+        drawBatch *Batch = &Commands->Batches[BatchIndex];
+
+        vertex *Vertices = MeshData[Batch->Mesh].Vertices;
+        int VertexCount = MeshData[Batch->Mesh].VertexCount;
+
+        if(Batch->Mesh == MESH_BACKGROUND) {
+            if(!Background) continue;
+            Vertices = Background->Vertices;
+            VertexCount = Background->VertexCount;
+        }
+
+        int FirstVertex = 0;
+        if(Batch->VertexCount) {
+            FirstVertex = Batch->FirstVertex;
+            VertexCount = Batch->VertexCount;
+        }
+
+        if(VertexCount > Rasterizer->ClipCapacity) {
+            float *Clip = realloc(Rasterizer->Clip, (size_t)VertexCount * 4 * sizeof(float));
+            if(!Clip) continue;
+            Rasterizer->Clip = Clip;
+            Rasterizer->ClipCapacity = VertexCount;
+        }
+
+        for(int InstanceIndex = 0; InstanceIndex < Batch->Count; ++InstanceIndex) {
+            instance *Instance = &Commands->Instances[Batch->First + InstanceIndex];
+
+            TransformPoints(ViewProjection, Instance->Position, &Vertices[FirstVertex].Position,
+                            sizeof(vertex), VertexCount, Rasterizer->Clip);
+
+            for(int Vertex = 0; Vertex + 2 < VertexCount; Vertex += 3) {
+                float *Clip = Rasterizer->Clip + Vertex * 4;
+
+                color VertexColor = Vertices[FirstVertex + Vertex].Color;
+                color Color = {
+                    VertexColor.R * Instance->Color.R,
+                    VertexColor.G * Instance->Color.G,
+                    VertexColor.B * Instance->Color.B,
+                    VertexColor.A * Instance->Color.A,
+                };
+
+                AddTriangle(Rasterizer, Clip, PackColor(Color));
+            }
+        }
+    }
+}
+
+// Top and left edges own the pixels exactly on them, so triangles
+// sharing an edge never both fill a pixel. For counter clockwise
+// triangles top edges run to the left and left edges run down.
+
+int IsTopLeft(float X0, float Y0, float X1, float Y1) {
+    return (Y0 == Y1 && X1 < X0) || (Y1 > Y0);
+}
+
+void FillTile(rasterizer *Rasterizer, int Tile) {
+
+    framebuffer *Target = &Rasterizer->Target;
+
+    int TileX = Tile % Rasterizer->XTiles;
+    int TileY = Tile / Rasterizer->XTiles;
+
+    int MinX = TileX * Rasterizer->TileSize;
+    int MinY = TileY * Rasterizer->TileSize;
+    int MaxX = MinX + Rasterizer->TileSize - 1;
+    int MaxY = MinY + Rasterizer->TileSize - 1;
+    if(MaxX > Target->Width - 1) MaxX = Target->Width - 1;
+    if(MaxY > Target->Height - 1) MaxY = Target->Height - 1;
+
+    uint32_t *Pixels = (uint32_t *)Target->Pixels;
+
+    // Clear
+
+    uint32_t Clear = PackColor(Rasterizer->ClearColor);
+    for(int Y = MinY; Y <= MaxY; ++Y) {
+        for(int X = MinX; X <= MaxX; ++X) {
+            Pixels[Y * Target->Width + X] = Clear;
+        }
+    }
+
+    for(int Index = 0; Index < Rasterizer->TriangleCount; ++Index) {
+        rasterTriangle *Triangle = &Rasterizer->Triangles[Index];
+
+        int StartX = Triangle->MinX > MinX ? Triangle->MinX : MinX;
+        int StartY = Triangle->MinY > MinY ? Triangle->MinY : MinY;
+        int EndX = Triangle->MaxX < MaxX ? Triangle->MaxX : MaxX;
+        int EndY = Triangle->MaxY < MaxY ? Triangle->MaxY : MaxY;
+        if(StartX > EndX || StartY > EndY) continue;
+
+        float *TX = Triangle->X;
+        float *TY = Triangle->Y;
+
+        // Edge I goes from vertex I to vertex I + 1
+
+        float StepX[3], StepY[3], Row[3];
+        int TopLeft[3];
+        float CenterX = StartX + 0.5f;
+        float CenterY = StartY + 0.5f;
+
+        for(int Edge = 0; Edge < 3; ++Edge) {
+            int Next = (Edge + 1) % 3;
+            StepX[Edge] = TY[Next] - TY[Edge];
+            StepY[Edge] = TX[Edge] - TX[Next];
+            Row[Edge] = (CenterX - TX[Edge]) * StepX[Edge] + (CenterY - TY[Edge]) * StepY[Edge];
+            TopLeft[Edge] = IsTopLeft(TX[Edge], TY[Edge], TX[Next], TY[Next]);
+        }
+
+        for(int Y = StartY; Y <= EndY; ++Y) {
+            float E0 = Row[0], E1 = Row[1], E2 = Row[2];
+            uint32_t *Pixel = Pixels + Y * Target->Width + StartX;
+
+            for(int X = StartX; X <= EndX; ++X) {
+                int Inside = (E0 > 0.0f || (E0 == 0.0f && TopLeft[0])) &&
+                             (E1 > 0.0f || (E1 == 0.0f && TopLeft[1])) &&
+                             (E2 > 0.0f || (E2 == 0.0f && TopLeft[2]));
+                if(Inside) {
+                    *Pixel = Triangle->Color;
+                }
+                ++Pixel;
+                E0 += StepX[0]; E1 += StepX[1]; E2 += StepX[2];
+            }
+
+            Row[0] += StepY[0]; Row[1] += StepY[1]; Row[2] += StepY[2];
+        }
+    }
+}
+
+void FillTilesJob(void *Data, int First, int Last) {
+    for(int Tile = First; Tile < Last; ++Tile) {
+        FillTile(Data, Tile);
+    }
+}
+
+void RasterizeCommands(rasterizer *Rasterizer, commandList *Commands, backgroundMesh *Background) {
+
+    SetupTriangles(Rasterizer, Commands, Background);
+
+    int TileCount = Rasterizer->XTiles * Rasterizer->YTiles;
+
+    if(Rasterizer->Pool) {
+        RunJob(Rasterizer->Pool, FillTilesJob, Rasterizer, TileCount, 1);
+    } else {
+        FillTilesJob(Rasterizer, 0, TileCount);
+    }
+}
+
+// Image files
+
+int WritePPM(framebuffer *Framebuffer, char *Path) {
+    FILE *File = fopen(Path, "wb");
+    if(!File) return 0;
+
+    fprintf(File, "P6\n%d %d\n255\n", Framebuffer->Width, Framebuffer->Height);
+    for(int Index = 0; Index < Framebuffer->Width * Framebuffer->Height; ++Index) {
+        fwrite(Framebuffer->Pixels + Index * 4, 1, 3, File);
+    }
+
+    return fclose(File) == 0;
+}
+
+// Reads a binary PPM written by WritePPM() into a new framebuffer
+
+int ReadPPM(framebuffer *Framebuffer, char *Path) {
+    FILE *File = fopen(Path, "rb");
+    if(!File) return 0;
+
+    int Width, Height, Max;
+    if(fscanf(File, "P6 %d %d %d", &Width, &Height, &Max) != 3 || Max != 255 ||
+       fgetc(File) == EOF || !CreateFramebuffer(Framebuffer, Width, Height)) {
+        fclose(File);
+        return 0;
+    }
+
+    int Result = 1;
+    for(int Index = 0; Index < Width * Height && Result; ++Index) {
+        uint8_t *Pixel = Framebuffer->Pixels + Index * 4;
+        Result = fread(Pixel, 1, 3, File) == 3;
+        Pixel[3] = 255;
+    }
+
+    fclose(File);
+    if(!Result) FreeFramebuffer(Framebuffer);
+    return Result;
+}
+
+uint32_t Crc32(uint32_t Crc, uint8_t *Data, size_t Size) {
+    Crc = ~Crc;
+    for(size_t Index = 0; Index < Size; ++Index) {
+        Crc ^= Data[Index];
+        for(int Bit = 0; Bit < 8; ++Bit) {
+            Crc = (Crc >> 1) ^ (0xEDB88320u & (0u - (Crc & 1)));
+        }
+    }
+    return ~Crc;
+}
+
+void WriteBigEndian32(FILE *File, uint32_t Value) {
+    uint8_t Bytes[4] = {Value >> 24, Value >> 16, Value >> 8, Value};
+    fwrite(Bytes, 1, 4, File);
+}
+
+void WritePNGChunk(FILE *File, char *Type, uint8_t *Data, uint32_t Size) {
+    WriteBigEndian32(File, Size);
+    uint32_t Crc = Crc32(0, (uint8_t *)Type, 4);
+    Crc = Crc32(Crc, Data, Size);
+    fwrite(Type, 1, 4, File);
+    fwrite(Data, 1, Size, File);
+    WriteBigEndian32(File, Crc);
+}
+
+// RGBA PNG with uncompressed (stored) deflate blocks, big but needs no
+// compression library
+
+int WritePNG(framebuffer *Framebuffer, char *Path) {
+
+    int Width = Framebuffer->Width;
+    int Height = Framebuffer->Height;
+
+    // Filter byte + pixels per row
+
+    size_t RowSize = 1 + (size_t)Width * 4;
+    size_t RawSize = RowSize * Height;
+    size_t BlockCount = (RawSize + 65534) / 65535;
+    size_t DataSize = 2 + RawSize + BlockCount * 5 + 4;
+
+    uint8_t *Data = malloc(DataSize);
+    uint8_t *Raw = malloc(RawSize);
+    if(!Data || !Raw) {
+        free(Data);
+        free(Raw);
+        return 0;
+    }
+
+    for(int Y = 0; Y < Height; ++Y) {
+        Raw[Y * RowSize] = 0;
+        memcpy(Raw + Y * RowSize + 1, Framebuffer->Pixels + (size_t)Y * Width * 4, (size_t)Width * 4);
+    }
+
+    // zlib stream: header, stored blocks, adler32
+
+    uint8_t *Out = Data;
+    *Out++ = 0x78;
+    *Out++ = 0x01;
+
+    uint32_t A = 1, B = 0;
+    for(size_t Offset = 0; Offset < RawSize; Offset += 65535) {
+        size_t Size = RawSize - Offset < 65535 ? RawSize - Offset : 65535;
+        *Out++ = (Offset + Size == RawSize) ? 1 : 0;
+        *Out++ = Size & 0xFF;
+        *Out++ = (Size >> 8) & 0xFF;
+        *Out++ = ~Size & 0xFF;
+        *Out++ = (~Size >> 8) & 0xFF;
+        memcpy(Out, Raw + Offset, Size);
+        Out += Size;
+
+        for(size_t Index = 0; Index < Size; ++Index) {
+            A = (A + Raw[Offset + Index]) % 65521;
+            B = (B + A) % 65521;
+        }
+    }
+
+    uint32_t Adler = (B << 16) | A;
+    *Out++ = Adler >> 24;
+    *Out++ = Adler >> 16;
+    *Out++ = Adler >> 8;
+    *Out++ = Adler;
+
+    FILE *File = fopen(Path, "wb");
+    int Result = File != 0;
+
+    if(File) {
+        uint8_t Signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+        uint8_t Header[13] = {
+            Width >> 24, Width >> 16, Width >> 8, Width,
+            Height >> 24, Height >> 16, Height >> 8, Height,
+            8, 6, 0, 0, 0, // 8 bit RGBA, deflate, no filter, no interlace
+        };
+        fwrite(Signature, 1, 8, File);
+        WritePNGChunk(File, "IHDR", Header, sizeof(Header));
+        WritePNGChunk(File, "IDAT", Data, (uint32_t)(Out - Data));
+        WritePNGChunk(File, "IEND", 0, 0);
+        Result = fclose(File) == 0;
+    }
+
+    free(Data);
+    free(Raw);
+    return Result;
+}
+
+// Number of pixels whose RGB differ by more than Tolerance in any
+// channel, or -1 if the sizes differ
+
+long CompareFramebuffers(framebuffer *A, framebuffer *B, int Tolerance) {
+    if(A->Width != B->Width || A->Height != B->Height) return -1;
+
+    long Different = 0;
+    for(int Index = 0; Index < A->Width * A->Height; ++Index) {
+        for(int Channel = 0; Channel < 3; ++Channel) {
+            int Delta = (int)A->Pixels[Index * 4 + Channel] - (int)B->Pixels[Index * 4 + Channel];
+            if(Delta > Tolerance || Delta < -Tolerance) {
+                ++Different;
+                break;
+            }
+        }
+    }
+    return Different;
+}
+
+#endif
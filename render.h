@@ -0,0 +1,531 @@
+#ifndef RENDER_H
+#define RENDER_H
+
+// Platform-free side of rendering. A frame is recorded into a command
+// list: one instance (position + color) per object, grouped into
+// batches of consecutive instances that use the same mesh. A backend
+// then uploads all instances at once and issues one instanced draw per
+// batch. Drawing order is kept, so a new batch starts whenever the mesh
+// changes.
+//
+// Vertices carry their own color which the backend multiplies with the
+// instance color. Small meshes use white vertices and get their color
+// from the instance, the baked background is the other way around.
+
+#include "game.h"
+#include "particles.h"
+#include "matrix.h"
+
+// Meshes before MESH_BACKGROUND are fixed and live in MeshData, the
+// background mesh is baked from the tiles by BakeBackground()
+enum {MESH_RECTANGLE, MESH_PIPE, MESH_BACKGROUND, MESH_COUNT};
+
+#define MAX_INSTANCES 131072
+#define MAX_BATCHES 64
+#define MAX_MESH_VERTICES 6
+#define BACKGROUND_CHUNK_SIZE 10
+
+typedef struct {
+    v3 Position;
+    color Color;
+} vertex;
+
+typedef struct {
+    vertex Vertices[MAX_MESH_VERTICES];
+    int VertexCount;
+} meshData;
+
+// All background tiles merged into one mesh. Rebuilt only when the tile
+// counts or the version change, callers bump the version whenever they
+// change tile colors.
+//
+// The tiles are laid out in a uniform grid of chunks of
+// BACKGROUND_CHUNK_SIZE * BACKGROUND_CHUNK_SIZE tiles, each chunk a
+// contiguous range of vertices, so off-screen chunks can be skipped.
+typedef struct {
+    vertex *Vertices;
+    int VertexCount;
+    int XTiles;
+    int YTiles;
+    int Version;
+    int Baked;
+
+    int XChunks;
+    int YChunks;
+    int *ChunkFirst;
+    int *ChunkCount;
+} backgroundMesh;
+
+// World space rectangle the camera can see
+typedef struct {
+    float MinX;
+    float MaxX;
+    float MinY;
+    float MaxY;
+} bounds;
+
+typedef struct {
+    v3 Position;
+    color Color;
+} instance;
+
+// VertexCount 0 draws the whole mesh, otherwise only
+// [FirstVertex, FirstVertex + VertexCount)
+typedef struct {
+    int Mesh;
+    int First;
+    int Count;
+    int FirstVertex;
+    int VertexCount;
+} drawBatch;
+
+typedef struct {
+    // View times projection, multiplied once per frame
+    matrix ViewProjection;
+
+    instance Instances[MAX_INSTANCES];
+    int InstanceCount;
+
+    drawBatch Batches[MAX_BATCHES];
+    int BatchCount;
+
+    int Dropped;
+
+    // Objects sent to the backend and objects skipped for being off
+    // screen, a background chunk counts as one object
+    int Submitted;
+    int Culled;
+} commandList;
+
+meshData MeshData[MESH_COUNT];
+
+// Trail pieces move with the pipes, see PushWorld(), and fade from
+// ColorTrail into ColorBackground at 0.005 per channel and step. They
+// last as long as the ring keeps them, MAX_TRAIL_LENGTH pieces of
+// TrailSpawnTicks each, which InitMeshData() sets as the Lifetime.
+particleEffect TrailEffect = {
+    .StartColor = {0.3f, 0.3f, 0.3f, 1.0f},
+    .EndColor = {0.2f, 0.2f, 0.2f, 1.0f},
+    .FadeTime = 20.0f,
+    .Size = 0.5f,
+};
+
+// Two triangles centered on the origin
+
+void SetRectangleMesh(meshData *Mesh, float Width, float Height) {
+    float W = Width / 2.0f;
+    float H = Height / 2.0f;
+    color White = {1.0f, 1.0f, 1.0f, 1.0f};
+    vertex Vertices[] = {
+        {{-W, -H, 0.0f}, White},
+        {{-W, H, 0.0f}, White},
+        {{W, H, 0.0f}, White},
+        {{-W, -H, 0.0f}, White},
+        {{W, H, 0.0f}, White},
+        {{W, -H, 0.0f}, White},
+    };
+    memcpy(Mesh->Vertices, Vertices, sizeof(Vertices));
+    Mesh->VertexCount = 6;
+}
+
+void InitMeshData() {
+    SetRectangleMesh(&MeshData[MESH_RECTANGLE], 1.0f, 1.0f);
+    SetRectangleMesh(&MeshData[MESH_PIPE], PipeWidth, PipeHeight);
+    TrailEffect.Lifetime = (float)(MAX_TRAIL_LENGTH * TrailSpawnTicks);
+}
+
+void ResetCommands(commandList *Commands) {
+    Commands->InstanceCount = 0;
+    Commands->BatchCount = 0;
+    Commands->Dropped = 0;
+    Commands->Submitted = 0;
+    Commands->Culled = 0;
+}
+
+void PushInstance(commandList *Commands, int Mesh, v3 Position, color Color) {
+
+    if(Commands->InstanceCount >= MAX_INSTANCES) {
+        ++Commands->Dropped;
+        return;
+    }
+
+    drawBatch *Batch = Commands->BatchCount ? &Commands->Batches[Commands->BatchCount - 1] : 0;
+
+    if(!Batch || Batch->Mesh != Mesh || Batch->VertexCount) {
+        if(Commands->BatchCount >= MAX_BATCHES) {
+            ++Commands->Dropped;
+            return;
+        }
+        Batch = &Commands->Batches[Commands->BatchCount++];
+        *Batch = (drawBatch){.Mesh = Mesh, .First = Commands->InstanceCount};
+    }
+
+    Commands->Instances[Commands->InstanceCount++] = (instance){Position, Color};
+    ++Batch->Count;
+}
+
+// Background tile colors, about 3% of the tiles are lighter
+void FillBackground(color *Background, int XTiles, int YTiles, random *Random) {
+    for(int Index = 0; Index < XTiles * YTiles; ++Index) {
+        Background[Index] = ColorBackground;
+        if(RandomBelow(Random, 100) < 3) {
+            Background[Index] = ColorBackgroundLighter;
+        }
+    }
+}
+
+void FreeBackgroundMesh(backgroundMesh *Mesh) {
+    free(Mesh->Vertices);
+    free(Mesh->ChunkFirst);
+    free(Mesh->ChunkCount);
+    *Mesh = (backgroundMesh){0};
+}
+
+// Returns 1 if the mesh was (re)built and needs to be uploaded again,
+// -1 if it could not be allocated, which leaves it empty
+
+int BakeBackground(backgroundMesh *Mesh, color *Background, int XTiles, int YTiles, int Version) {
+
+    if(Mesh->Baked &&
+       Mesh->XTiles == XTiles &&
+       Mesh->YTiles == YTiles &&
+       Mesh->Version == Version) {
+        return 0;
+    }
+
+    meshData *Tile = &MeshData[MESH_RECTANGLE];
+    int VertexCount = XTiles * YTiles * Tile->VertexCount;
+
+    if(VertexCount > Mesh->VertexCount || !Mesh->Vertices) {
+        free(Mesh->Vertices);
+        Mesh->Vertices = malloc((size_t)VertexCount * sizeof(vertex));
+    }
+
+    int XChunks = (XTiles + BACKGROUND_CHUNK_SIZE - 1) / BACKGROUND_CHUNK_SIZE;
+    int YChunks = (YTiles + BACKGROUND_CHUNK_SIZE - 1) / BACKGROUND_CHUNK_SIZE;
+
+    if(XChunks * YChunks > Mesh->XChunks * Mesh->YChunks || !Mesh->ChunkFirst) {
+        free(Mesh->ChunkFirst);
+        free(Mesh->ChunkCount);
+        Mesh->ChunkFirst = malloc(XChunks * YChunks * sizeof(int));
+        Mesh->ChunkCount = malloc(XChunks * YChunks * sizeof(int));
+    }
+
+    if(!Mesh->Vertices || !Mesh->ChunkFirst || !Mesh->ChunkCount) {
+        FreeBackgroundMesh(Mesh);
+        return -1;
+    }
+
+    Mesh->XChunks = XChunks;
+    Mesh->YChunks = YChunks;
+
+    vertex *Vertex = Mesh->Vertices;
+
+    for(int ChunkY = 0; ChunkY < YChunks; ++ChunkY) {
+        for(int ChunkX = 0; ChunkX < XChunks; ++ChunkX) {
+
+            int Chunk = ChunkY * XChunks + ChunkX;
+            Mesh->ChunkFirst[Chunk] = (int)(Vertex - Mesh->Vertices);
+
+            int LastY = (ChunkY + 1) * BACKGROUND_CHUNK_SIZE;
+            int LastX = (ChunkX + 1) * BACKGROUND_CHUNK_SIZE;
+            if(LastY > YTiles) LastY = YTiles;
+            if(LastX > XTiles) LastX = XTiles;
+
+            for(int Y = ChunkY * BACKGROUND_CHUNK_SIZE; Y < LastY; ++Y) {
+                for(int X = ChunkX * BACKGROUND_CHUNK_SIZE; X < LastX; ++X) {
+                    color Color = Background[Y * XTiles + X];
+                    for(int Index = 0; Index < Tile->VertexCount; ++Index) {
+                        v3 Position = Tile->Vertices[Index].Position;
+                        *Vertex++ = (vertex){{Position.X + X, Position.Y + Y, Position.Z}, Color};
+                    }
+                }
+            }
+
+            Mesh->ChunkCount[Chunk] = (int)(Vertex - Mesh->Vertices) - Mesh->ChunkFirst[Chunk];
+        }
+    }
+
+    Mesh->VertexCount = VertexCount;
+    Mesh->XTiles = XTiles;
+    Mesh->YTiles = YTiles;
+    Mesh->Version = Version;
+    Mesh->Baked = 1;
+
+    return 1;
+}
+
+// Row vector matrices, the way shaders.hlsl multiplies them
+
+matrix GetProjectionMatrix(float AspectRatio, float Height, float Near, float Far) {
+    return (matrix){
+        2.0f * Near / AspectRatio, 0.0f, 0.0f, 0.0f,
+        0.0f, 2.0f * Near / Height, 0.0f, 0.0f,
+        0.0f, 0.0f, Far / (Far - Near), 1.0f,
+        0.0f, 0.0f, Near * Far / (Near - Far), 0.0f
+    };
+}
+
+matrix GetViewMatrix(v3 CameraPosition) {
+    return (matrix){
+        1.0f, 0.0f, 0.0f, 0.0f,
+        0.0f, 1.0f, 0.0f, 0.0f,
+        0.0f, 0.0f, 1.0f, 0.0f,
+        -CameraPosition.X, -CameraPosition.Y, -CameraPosition.Z, 1.0f,
+    };
+}
+
+// Visible bounds on the plane at world Z: the screen corners are taken
+// back through the inverse of ViewProjection, at depth 0 and 1, and the
+// lines between them meet the plane. Works for any camera that looks
+// at the plane; one that cannot see it, or has no inverse, gets
+// bounds that hold everything.
+
+bounds GetVisibleBounds(matrix *ViewProjection, float Z) {
+
+    bounds Everything = {-1e30f, 1e30f, -1e30f, 1e30f};
+    bounds Result = {1e30f, -1e30f, 1e30f, -1e30f};
+
+    matrix Inverse;
+    if(!InvertMatrix(ViewProjection, &Inverse)) return Everything;
+
+    for(int Corner = 0; Corner < 4; ++Corner) {
+        float ScreenX = (Corner & 1) ? 1.0f : -1.0f;
+        float ScreenY = (Corner & 2) ? 1.0f : -1.0f;
+
+        float Near[4], Far[4];
+        TransformPoint(&Inverse, (v3){ScreenX, ScreenY, 0.0f}, Near);
+        TransformPoint(&Inverse, (v3){ScreenX, ScreenY, 1.0f}, Far);
+        if(Near[3] == 0.0f || Far[3] == 0.0f) return Everything;
+
+        float NearX = Near[0] / Near[3], NearY = Near[1] / Near[3], NearZ = Near[2] / Near[3];
+        float FarX = Far[0] / Far[3], FarY = Far[1] / Far[3], FarZ = Far[2] / Far[3];
+        if(FarZ == NearZ) return Everything;
+
+        float T = (Z - NearZ) / (FarZ - NearZ);
+        if(T < 0.0f) return Everything;
+
+        float X = NearX + (FarX - NearX) * T;
+        float Y = NearY + (FarY - NearY) * T;
+        if(X < Result.MinX) Result.MinX = X;
+        if(X > Result.MaxX) Result.MaxX = X;
+        if(Y < Result.MinY) Result.MinY = Y;
+        if(Y > Result.MaxY) Result.MaxY = Y;
+    }
+
+    return Result;
+}
+
+// Does a box centered at X, Y with the given half extents touch Bounds?
+
+int IsVisible(bounds *Bounds, float X, float Y, float HalfWidth, float HalfHeight) {
+    if(X + HalfWidth < Bounds->MinX) return 0;
+    if(X - HalfWidth > Bounds->MaxX) return 0;
+    if(Y + HalfHeight < Bounds->MinY) return 0;
+    if(Y - HalfHeight > Bounds->MaxY) return 0;
+    return 1;
+}
+
+// Queues a vertex range of a mesh as its own batch. A range that
+// continues the previous one with the same instance just extends it.
+
+void PushMeshRange(commandList *Commands, int Mesh, int FirstVertex, int VertexCount, v3 Position, color Color) {
+
+    drawBatch *Batch = Commands->BatchCount ? &Commands->Batches[Commands->BatchCount - 1] : 0;
+
+    if(Batch && Batch->Mesh == Mesh && Batch->VertexCount &&
+       Batch->FirstVertex + Batch->VertexCount == FirstVertex) {
+        Batch->VertexCount += VertexCount;
+        return;
+    }
+
+    if(Commands->InstanceCount >= MAX_INSTANCES || Commands->BatchCount >= MAX_BATCHES) {
+        ++Commands->Dropped;
+        return;
+    }
+
+    Commands->Batches[Commands->BatchCount++] = (drawBatch){
+        .Mesh = Mesh,
+        .First = Commands->InstanceCount,
+        .Count = 1,
+        .FirstVertex = FirstVertex,
+        .VertexCount = VertexCount,
+    };
+    Commands->Instances[Commands->InstanceCount++] = (instance){Position, Color};
+}
+
+// Baked background, only the chunks that touch Visible. Neighbouring
+// visible chunks in a row share one draw. Visible 0 draws everything.
+
+void PushBakedBackground(commandList *Commands, backgroundMesh *Mesh, bounds *Visible) {
+
+    color White = {1.0f, 1.0f, 1.0f, 1.0f};
+    float Half = BACKGROUND_CHUNK_SIZE / 2.0f;
+
+    for(int ChunkY = 0; ChunkY < Mesh->YChunks; ++ChunkY) {
+        for(int ChunkX = 0; ChunkX < Mesh->XChunks; ++ChunkX) {
+
+            // Tile centers are at whole numbers, so a chunk starts half
+            // a tile before its first tile
+
+            float CenterX = ChunkX * BACKGROUND_CHUNK_SIZE - 0.5f + Half;
+            float CenterY = ChunkY * BACKGROUND_CHUNK_SIZE - 0.5f + Half;
+
+            if(Visible && !IsVisible(Visible, CenterX, CenterY, Half, Half)) {
+                ++Commands->Culled;
+                continue;
+            }
+
+            int Chunk = ChunkY * Mesh->XChunks + ChunkX;
+            PushMeshRange(Commands, MESH_BACKGROUND, Mesh->ChunkFirst[Chunk], Mesh->ChunkCount[Chunk],
+                          (v3){0}, White);
+            ++Commands->Submitted;
+        }
+    }
+}
+
+// One instance per tile, the way the background was drawn before it
+// got baked. Background tile X, Y has the color Background[Y * XTiles + X]
+
+void PushBackground(commandList *Commands, color *Background, int XTiles, int YTiles) {
+    for(int Y = 0; Y < YTiles; ++Y) {
+        for(int X = 0; X < XTiles; ++X) {
+            PushInstance(Commands, MESH_RECTANGLE, (v3){X, Y}, Background[Y * XTiles + X]);
+        }
+    }
+}
+
+// Pipes, trail and bird, blended Alpha of the way from the previous
+// step. Anything outside Visible is skipped, Visible 0 draws everything.
+
+void PushCulled(commandList *Commands, bounds *Visible, int Mesh, v3 Position, color Color,
+                float HalfWidth, float HalfHeight) {
+    if(Visible && !IsVisible(Visible, Position.X, Position.Y, HalfWidth, HalfHeight)) {
+        ++Commands->Culled;
+        return;
+    }
+    PushInstance(Commands, Mesh, Position, Color);
+    ++Commands->Submitted;
+}
+
+// A whole pool as one batch of rectangles, Time being the step with the
+// blend factor added. Particles past their lifetime are skipped, so are
+// the ones outside Visible unless it is 0.
+
+void PushParticles(commandList *Commands, particlePool *Pool, float Time, bounds *Visible) {
+
+    if(!Pool->Count) return;
+
+    // Every particle is written before it is known to be kept, so there
+    // has to be a free slot for it
+    if(Commands->InstanceCount >= MAX_INSTANCES) {
+        Commands->Dropped += Pool->Count;
+        return;
+    }
+
+    drawBatch *Batch = Commands->BatchCount ? &Commands->Batches[Commands->BatchCount - 1] : 0;
+
+    if(!Batch || Batch->Mesh != MESH_RECTANGLE || Batch->VertexCount) {
+        if(Commands->BatchCount >= MAX_BATCHES) {
+            Commands->Dropped += Pool->Count;
+            return;
+        }
+        Batch = &Commands->Batches[Commands->BatchCount++];
+        *Batch = (drawBatch){.Mesh = MESH_RECTANGLE, .First = Commands->InstanceCount};
+    }
+
+    particleEffect *Effect = &Pool->Effect;
+    float HalfX = Effect->Acceleration.X / 2.0f;
+    float HalfY = Effect->Acceleration.Y / 2.0f;
+    float FadeRate = GetFadeRate(Effect);
+    color Start = Effect->StartColor;
+    color Change = {
+        Effect->EndColor.R - Start.R,
+        Effect->EndColor.G - Start.G,
+        Effect->EndColor.B - Start.B,
+        Effect->EndColor.A - Start.A,
+    };
+
+    bounds Bounds = Visible ? *Visible : (bounds){-1e30f, 1e30f, -1e30f, 1e30f};
+    Bounds.MinX -= Effect->Size;
+    Bounds.MaxX += Effect->Size;
+    Bounds.MinY -= Effect->Size;
+    Bounds.MaxY += Effect->Size;
+
+    // Every particle is written and then kept or not, so whether it is
+    // seen costs no branch. That takes one slot past the last kept one,
+    // Count stays below MAX_INSTANCES.
+
+    instance *Instances = Commands->Instances;
+    int Count = Commands->InstanceCount;
+    int Last = MAX_INSTANCES - 1;
+    int Expired = 0;
+    int Dropped = 0;
+
+    for(int Index = 0; Index < Pool->Count; ++Index) {
+        float Age = Time - Pool->SpawnTime[Index];
+        float X = Pool->X[Index] + (Pool->VelocityX[Index] + HalfX * Age) * Age;
+        float Y = Pool->Y[Index] + (Pool->VelocityY[Index] + HalfY * Age) * Age;
+
+        float T = Age * FadeRate;
+        T = T < 0.0f ? 0.0f : T;
+        T = T > 1.0f ? 1.0f : T;
+
+        Instances[Count] = (instance){
+            {X, Y, 0.0f},
+            {Start.R + Change.R * T, Start.G + Change.G * T, Start.B + Change.B * T, Start.A + Change.A * T},
+        };
+
+        int Alive = (Age >= 0.0f) & (Age <= Effect->Lifetime);
+        int Seen = (X >= Bounds.MinX) & (X <= Bounds.MaxX) & (Y >= Bounds.MinY) & (Y <= Bounds.MaxY);
+        int Fits = Count < Last;
+        Count += Alive & Seen & Fits;
+        Dropped += Alive & Seen & !Fits;
+        Expired += !Alive;
+    }
+
+    int Added = Count - Commands->InstanceCount;
+    Batch->Count += Added;
+    Commands->InstanceCount = Count;
+    Commands->Submitted += Added;
+    Commands->Dropped += Dropped;
+    Commands->Culled += Pool->Count - Expired - Added - Dropped;
+}
+
+void PushWorld(commandList *Commands, world *World, float Alpha, bounds *Visible) {
+
+    // Pipes
+
+    pipeStore *Pipes = &World->Pipes;
+
+    for(int Index = 0; Index < Pipes->Ring.Length; ++Index) {
+        color Color = ColorPipe;
+        if(World->PracticeMode) {
+            Color = Pipes->Hit[Index] ? ColorPipeHit : ColorPipePractice;
+        }
+        float X = Pipes->PreviousX[Index] + (Pipes->X[Index] - Pipes->PreviousX[Index]) * Alpha;
+        PushCulled(Commands, Visible, MESH_PIPE, (v3){X, Pipes->Y[Index]}, Color,
+                   PipeWidth / 2.0f, PipeHeight / 2.0f);
+    }
+
+    // Trail, added at the end of its step and moved along with the
+    // pipes ever since
+
+    trailStore *Trail = &World->Trail;
+    float PipeStep = DeltaTime * PipeSpeed;
+
+    for(int Index = 0; Index < Trail->Ring.Length; ++Index) {
+        float Age = (float)(World->Tick - Trail->SpawnTick[Index]) + Alpha;
+        float X = Trail->X[Index] - Age * PipeStep;
+        PushCulled(Commands, Visible, MESH_RECTANGLE, (v3){X, Trail->Y[Index]},
+                   GetParticleColor(&TrailEffect, Age), TrailEffect.Size, TrailEffect.Size);
+    }
+
+    // Bird
+
+    v3 Position = LerpV3(World->Bird.PreviousPosition, World->Bird.Position, Alpha);
+    PushCulled(Commands, Visible, MESH_RECTANGLE, Position, ColorBird,
+               BirdWidth / 2.0f, BirdHeight / 2.0f);
+}
+
+#endif
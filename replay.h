@@ -0,0 +1,265 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+// Input recording and replay. A replay is the world seed, the input of
+// every step run length encoded, and a hash of the world after every
+// step. Playing the inputs back from the same seed has to give the same
+// hashes. The first step where they differ is exactly where a change
+// altered behavior.
+//
+// Steps are UpdateWorld() calls, paused ones included, so they can be
+// more than World.Tick.
+//
+// File layout, all integers little endian:
+//
+//     "FBRP" Version Seed StepCount RunCount
+//     RunCount x { Steps (u32) Buttons (u8) }
+//     StepCount x Hash (u32)
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "game.h"
+
+#define REPLAY_VERSION 3
+
+enum {
+    BUTTON_FLAP = 1 << 0,
+    BUTTON_PAUSE = 1 << 1,
+    BUTTON_PRACTICE_MODE = 1 << 2,
+};
+
+typedef struct {
+    uint32_t Steps;
+    uint8_t Buttons;
+} inputRun;
+
+typedef struct {
+    uint32_t Seed;
+    uint32_t StepCount;
+
+    inputRun *Runs;
+    uint32_t RunCount;
+    uint32_t RunCapacity;
+
+    uint32_t *Hashes;
+    uint32_t HashCapacity;
+} replay;
+
+// Where playback is in a replay
+typedef struct {
+    uint32_t Step;
+    uint32_t Run;
+    uint32_t StepInRun;
+} replayCursor;
+
+uint8_t PackInput(input *Input) {
+    return (Input->Flap ? BUTTON_FLAP : 0) |
+           (Input->TogglePause ? BUTTON_PAUSE : 0) |
+           (Input->TogglePracticeMode ? BUTTON_PRACTICE_MODE : 0);
+}
+
+input UnpackInput(uint8_t Buttons) {
+    return (input){
+        .Flap = (Buttons & BUTTON_FLAP) != 0,
+        .TogglePause = (Buttons & BUTTON_PAUSE) != 0,
+        .TogglePracticeMode = (Buttons & BUTTON_PRACTICE_MODE) != 0,
+    };
+}
+
+// FNV-1a
+
+uint32_t HashBytes(uint32_t Hash, void *Data, size_t Size) {
+    uint8_t *Bytes = Data;
+    for(size_t Index = 0; Index < Size; ++Index) {
+        Hash ^= Bytes[Index];
+        Hash *= 16777619u;
+    }
+    return Hash;
+}
+
+// Hashes everything a step depends on. Previous positions only matter
+// to the renderer and are left out, and so is padding.
+
+uint32_t HashWorld(world *World) {
+    uint32_t Hash = 2166136261u;
+
+    Hash = HashBytes(Hash, World->Random.State, sizeof(World->Random.State));
+    Hash = HashBytes(Hash, &World->Bird.Position, sizeof(v3));
+    Hash = HashBytes(Hash, &World->Bird.Velocity, sizeof(v3));
+
+    pipeStore *Pipes = &World->Pipes;
+    Hash = HashBytes(Hash, &Pipes->Ring, sizeof(ring));
+    Hash = HashBytes(Hash, Pipes->X, Pipes->Ring.Length * sizeof(float));
+    Hash = HashBytes(Hash, Pipes->Y, Pipes->Ring.Length * sizeof(float));
+    Hash = HashBytes(Hash, Pipes->Hit, Pipes->Ring.Length);
+
+    trailStore *Trail = &World->Trail;
+    Hash = HashBytes(Hash, &Trail->Ring, sizeof(ring));
+    Hash = HashBytes(Hash, Trail->SpawnTick, Trail->Ring.Length * sizeof(int));
+    Hash = HashBytes(Hash, Trail->X, Trail->Ring.Length * sizeof(float));
+    Hash = HashBytes(Hash, Trail->Y, Trail->Ring.Length * sizeof(float));
+
+    int Counters[] = {
+        World->Tick, World->PipeTicks, World->TrailTicks, World->Score,
+        World->PracticeMode, World->Pause, World->Running,
+    };
+    Hash = HashBytes(Hash, Counters, sizeof(Counters));
+
+    return Hash;
+}
+
+void InitReplay(replay *Replay, uint32_t Seed) {
+    memset(Replay, 0, sizeof(*Replay));
+    Replay->Seed = Seed;
+}
+
+void FreeReplay(replay *Replay) {
+    free(Replay->Runs);
+    free(Replay->Hashes);
+    memset(Replay, 0, sizeof(*Replay));
+}
+
+// Call after every UpdateWorld() with the input it got and the world it
+// left behind.
+
+int RecordStep(replay *Replay, input *Input, world *World) {
+
+    uint8_t Buttons = PackInput(Input);
+
+    inputRun *Last = Replay->RunCount ? &Replay->Runs[Replay->RunCount - 1] : 0;
+
+    if(Last && Last->Buttons == Buttons && Last->Steps < UINT32_MAX) {
+        ++Last->Steps;
+    } else {
+        if(Replay->RunCount >= Replay->RunCapacity) {
+            uint32_t Capacity = Replay->RunCapacity ? Replay->RunCapacity * 2 : 256;
+            inputRun *Runs = realloc(Replay->Runs, Capacity * sizeof(inputRun));
+            if(!Runs) return 0;
+            Replay->Runs = Runs;
+            Replay->RunCapacity = Capacity;
+        }
+        Replay->Runs[Replay->RunCount++] = (inputRun){1, Buttons};
+    }
+
+    if(Replay->StepCount >= Replay->HashCapacity) {
+        uint32_t Capacity = Replay->HashCapacity ? Replay->HashCapacity * 2 : 4096;
+        uint32_t *Hashes = realloc(Replay->Hashes, Capacity * sizeof(uint32_t));
+        if(!Hashes) return 0;
+        Replay->Hashes = Hashes;
+        Replay->HashCapacity = Capacity;
+    }
+
+    Replay->Hashes[Replay->StepCount++] = HashWorld(World);
+    return 1;
+}
+
+// Input for the step at the cursor, 0 once the replay is over
+
+int NextReplayInput(replay *Replay, replayCursor *Cursor, input *Input) {
+    if(Cursor->Run >= Replay->RunCount) return 0;
+
+    inputRun *Run = &Replay->Runs[Cursor->Run];
+    *Input = UnpackInput(Run->Buttons);
+
+    ++Cursor->Step;
+    if(++Cursor->StepInRun >= Run->Steps) {
+        ++Cursor->Run;
+        Cursor->StepInRun = 0;
+    }
+    return 1;
+}
+
+// Files
+
+void WriteU32(FILE *File, uint32_t Value) {
+    uint8_t Bytes[4] = {Value, Value >> 8, Value >> 16, Value >> 24};
+    fwrite(Bytes, 1, 4, File);
+}
+
+int ReadU32(FILE *File, uint32_t *Value) {
+    uint8_t Bytes[4];
+    if(fread(Bytes, 1, 4, File) != 4) return 0;
+    *Value = (uint32_t)Bytes[0] | (uint32_t)Bytes[1] << 8 |
+             (uint32_t)Bytes[2] << 16 | (uint32_t)Bytes[3] << 24;
+    return 1;
+}
+
+int WriteReplay(replay *Replay, char *Path) {
+    FILE *File = fopen(Path, "wb");
+    if(!File) return 0;
+
+    fwrite("FBRP", 1, 4, File);
+    WriteU32(File, REPLAY_VERSION);
+    WriteU32(File, Replay->Seed);
+    WriteU32(File, Replay->StepCount);
+    WriteU32(File, Replay->RunCount);
+
+    for(uint32_t Index = 0; Index < Replay->RunCount; ++Index) {
+        WriteU32(File, Replay->Runs[Index].Steps);
+        fputc(Replay->Runs[Index].Buttons, File);
+    }
+    for(uint32_t Index = 0; Index < Replay->StepCount; ++Index) {
+        WriteU32(File, Replay->Hashes[Index]);
+    }
+
+    return fclose(File) == 0;
+}
+
+int ReadReplay(replay *Replay, char *Path) {
+    FILE *File = fopen(Path, "rb");
+    if(!File) return 0;
+
+    InitReplay(Replay, 0);
+
+    char Magic[4];
+    uint32_t Version;
+    int Result = fread(Magic, 1, 4, File) == 4 && !memcmp(Magic, "FBRP", 4) &&
+                 ReadU32(File, &Version) && Version == REPLAY_VERSION &&
+                 ReadU32(File, &Replay->Seed) &&
+                 ReadU32(File, &Replay->StepCount) &&
+                 ReadU32(File, &Replay->RunCount);
+
+    // The counts come from the file, so they have to fit in what is left
+    // of it before anything gets allocated for them
+
+    if(Result) {
+        long Start = ftell(File);
+        Result = Start >= 0 && !fseek(File, 0, SEEK_END);
+        long End = Result ? ftell(File) : -1;
+        Result = Result && End >= Start && !fseek(File, Start, SEEK_SET);
+        uint64_t Needed = (uint64_t)Replay->RunCount * 5 + (uint64_t)Replay->StepCount * 4;
+        Result = Result && Needed <= (uint64_t)(End - Start);
+    }
+
+    if(Result) {
+        Replay->RunCapacity = Replay->RunCount;
+        Replay->HashCapacity = Replay->StepCount;
+        Replay->Runs = malloc(((size_t)Replay->RunCount + 1) * sizeof(inputRun));
+        Replay->Hashes = malloc(((size_t)Replay->StepCount + 1) * sizeof(uint32_t));
+        Result = Replay->Runs && Replay->Hashes;
+    }
+
+    uint64_t Steps = 0;
+    for(uint32_t Index = 0; Result && Index < Replay->RunCount; ++Index) {
+        int Buttons;
+        Result = ReadU32(File, &Replay->Runs[Index].Steps) && (Buttons = fgetc(File)) != EOF;
+        if(Result) {
+            Replay->Runs[Index].Buttons = (uint8_t)Buttons;
+            Steps += Replay->Runs[Index].Steps;
+        }
+    }
+    for(uint32_t Index = 0; Result && Index < Replay->StepCount; ++Index) {
+        Result = ReadU32(File, &Replay->Hashes[Index]);
+    }
+
+    fclose(File);
+
+    if(!Result || Steps != Replay->StepCount) {
+        FreeReplay(Replay);
+        return 0;
+    }
+    return 1;
+}
+
+#endif
@@ -1,14 +1,14 @@
 cbuffer constants : register(b0)
 {
-    row_major float4x4 model;
-    row_major float4x4 view;
-    row_major float4x4 projection;
-    float4 color;
+    row_major float4x4 viewProjection;
 };
 
 struct VS_Input
 {
 	float3 position: POSITION;
+	float4 color: COLOR;
+	float3 instancePosition: INSTANCE_POSITION;
+	float4 instanceColor: INSTANCE_COLOR;
 };
 
 struct VS_Output
@@ -20,12 +20,12 @@ struct VS_Output
 VS_Output vs_main(VS_Input input)
 {
 	VS_Output output;
-	output.position = mul(float4(input.position, 1.0f), mul(mul(model, view), projection));
-	output.color = color;
+	output.position = mul(float4(input.position + input.instancePosition, 1.0f), viewProjection);
+	output.color = input.color * input.instanceColor;
 	return output;
 };
 
 float4 ps_main(VS_Output input): SV_TARGET
 {
 	return input.color;
-};
\ No newline at end of file
+};
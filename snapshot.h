@@ -0,0 +1,297 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+// World snapshots. Everything a step reads or writes lives in the world
+// struct: bird, pipe and trail stores, the random generator and the
+// counters. It holds no pointers, and static data like the background
+// and the meshes stays outside. A snapshot in memory is therefore a
+// copy of the struct, a few hundred bytes, and restoring one is a copy
+// back. Rollback keeps a history of them, lookahead search clones them.
+//
+// The serialized form is for files and anything else that leaves the
+// process. It is independent of padding, struct layout and byte order
+// and only holds the live slots of the rings. All integers and floats
+// are 32 bit little endian, flags are one byte:
+//
+//     "FBSN" Version
+//     Seed Random.State[4] Tick PipeTicks TrailTicks Score
+//     PracticeMode Pause Running (u8)
+//     Bird: Position PreviousPosition Velocity (3 floats each) MaxVelocity
+//     Pipes: Length Index, Length x { X Y PreviousX Hit (u8) }
+//     Trail: Length Index, Length x { SpawnTick X Y }
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "game.h"
+
+#define SNAPSHOT_VERSION 2
+
+// Serialized sizes. Everything before the pipes, each pipe and each
+// trail piece. Both rings also store their length and index.
+#define SNAPSHOT_HEADER_SIZE (8 + 9 * 4 + 3 + 10 * 4)
+#define SNAPSHOT_PIPE_SIZE 13
+#define SNAPSHOT_TRAIL_SIZE 12
+
+// Largest serialized world, both rings full
+#define MAX_SNAPSHOT_SIZE (SNAPSHOT_HEADER_SIZE + 8 + MAX_PIPES_AMOUNT * SNAPSHOT_PIPE_SIZE + \
+                           8 + MAX_TRAIL_LENGTH * SNAPSHOT_TRAIL_SIZE)
+
+typedef world snapshot;
+
+// Last Capacity snapshots, for stepping back in time
+typedef struct {
+    snapshot *Snapshots;
+    int Capacity;
+    int Count;
+    int Next;
+} snapshotHistory;
+
+void SaveSnapshot(snapshot *Snapshot, world *World) {
+    *Snapshot = *World;
+}
+
+void RestoreSnapshot(world *World, snapshot *Snapshot) {
+    *World = *Snapshot;
+}
+
+int CreateSnapshotHistory(snapshotHistory *History, int Capacity) {
+    memset(History, 0, sizeof(*History));
+    History->Snapshots = malloc(Capacity * sizeof(snapshot));
+    History->Capacity = History->Snapshots ? Capacity : 0;
+    return History->Snapshots != 0;
+}
+
+void FreeSnapshotHistory(snapshotHistory *History) {
+    free(History->Snapshots);
+    memset(History, 0, sizeof(*History));
+}
+
+// Call with the world before the step that should be undoable
+void PushSnapshot(snapshotHistory *History, world *World) {
+    if(!History->Capacity) return;
+    SaveSnapshot(&History->Snapshots[History->Next], World);
+    History->Next = (History->Next + 1) % History->Capacity;
+    if(History->Count < History->Capacity) ++History->Count;
+}
+
+// Restores the world from Steps pushes ago, 1 being the last one, and
+// forgets everything pushed after it. Goes back as far as it can and
+// returns how far that was.
+
+int RewindSnapshots(snapshotHistory *History, world *World, int Steps) {
+    if(Steps > History->Count) Steps = History->Count;
+    if(Steps <= 0) return 0;
+
+    History->Next = (History->Next - Steps + History->Capacity) % History->Capacity;
+    History->Count -= Steps;
+    RestoreSnapshot(World, &History->Snapshots[History->Next]);
+    return Steps;
+}
+
+// Serialized form. The size is known from the ring lengths before
+// anything is read or written, so the fields themselves go through a
+// cursor without bounds checks.
+
+size_t GetSnapshotSize(int PipeCount, int TrailCount) {
+    return SNAPSHOT_HEADER_SIZE + 8 + PipeCount * SNAPSHOT_PIPE_SIZE +
+           8 + TrailCount * SNAPSHOT_TRAIL_SIZE;
+}
+
+void PutU32(uint8_t **At, uint32_t Value) {
+    uint8_t *Bytes = *At;
+    Bytes[0] = (uint8_t)Value;
+    Bytes[1] = (uint8_t)(Value >> 8);
+    Bytes[2] = (uint8_t)(Value >> 16);
+    Bytes[3] = (uint8_t)(Value >> 24);
+    *At += 4;
+}
+
+void PutU8(uint8_t **At, uint32_t Value) {
+    *(*At)++ = (uint8_t)Value;
+}
+
+void PutFloat(uint8_t **At, float Value) {
+    uint32_t Bits;
+    memcpy(&Bits, &Value, 4);
+    PutU32(At, Bits);
+}
+
+void PutV3(uint8_t **At, v3 Value) {
+    PutFloat(At, Value.X);
+    PutFloat(At, Value.Y);
+    PutFloat(At, Value.Z);
+}
+
+uint32_t GetU32(uint8_t **At) {
+    uint8_t *Bytes = *At;
+    *At += 4;
+    return (uint32_t)Bytes[0] | (uint32_t)Bytes[1] << 8 |
+           (uint32_t)Bytes[2] << 16 | (uint32_t)Bytes[3] << 24;
+}
+
+uint8_t GetU8(uint8_t **At) {
+    return *(*At)++;
+}
+
+float GetFloat(uint8_t **At) {
+    uint32_t Bits = GetU32(At);
+    float Value;
+    memcpy(&Value, &Bits, 4);
+    return Value;
+}
+
+v3 GetV3(uint8_t **At) {
+    v3 Value;
+    Value.X = GetFloat(At);
+    Value.Y = GetFloat(At);
+    Value.Z = GetFloat(At);
+    return Value;
+}
+
+// Returns the size written, 0 if it did not fit
+size_t SerializeWorld(world *World, uint8_t *Data, size_t Size) {
+    pipeStore *Pipes = &World->Pipes;
+    trailStore *Trail = &World->Trail;
+
+    size_t Needed = GetSnapshotSize(Pipes->Ring.Length, Trail->Ring.Length);
+    if(Size < Needed) return 0;
+
+    uint8_t *At = Data;
+
+    memcpy(At, "FBSN", 4);
+    At += 4;
+    PutU32(&At, SNAPSHOT_VERSION);
+
+    PutU32(&At, World->Seed);
+    for(int Index = 0; Index < 4; ++Index) {
+        PutU32(&At, World->Random.State[Index]);
+    }
+    PutU32(&At, (uint32_t)World->Tick);
+    PutU32(&At, (uint32_t)World->PipeTicks);
+    PutU32(&At, (uint32_t)World->TrailTicks);
+    PutU32(&At, (uint32_t)World->Score);
+    PutU8(&At, World->PracticeMode);
+    PutU8(&At, World->Pause);
+    PutU8(&At, World->Running);
+
+    bird *Bird = &World->Bird;
+    PutV3(&At, Bird->Position);
+    PutV3(&At, Bird->PreviousPosition);
+    PutV3(&At, Bird->Velocity);
+    PutFloat(&At, Bird->MaxVelocity);
+
+    PutU32(&At, (uint32_t)Pipes->Ring.Length);
+    PutU32(&At, (uint32_t)Pipes->Ring.Index);
+    for(int Slot = 0; Slot < Pipes->Ring.Length; ++Slot) {
+        PutFloat(&At, Pipes->X[Slot]);
+        PutFloat(&At, Pipes->Y[Slot]);
+        PutFloat(&At, Pipes->PreviousX[Slot]);
+        PutU8(&At, Pipes->Hit[Slot]);
+    }
+
+    PutU32(&At, (uint32_t)Trail->Ring.Length);
+    PutU32(&At, (uint32_t)Trail->Ring.Index);
+    for(int Slot = 0; Slot < Trail->Ring.Length; ++Slot) {
+        PutU32(&At, (uint32_t)Trail->SpawnTick[Slot]);
+        PutFloat(&At, Trail->X[Slot]);
+        PutFloat(&At, Trail->Y[Slot]);
+    }
+
+    return Needed;
+}
+
+// Length and index of a ring, 0 if they do not fit its capacity or are
+// not a state AddToRing() can get to: until the ring is full the next
+// slot is the one after the last, Index == Length.
+int GetRing(uint8_t **At, ring *Ring, int Capacity) {
+    uint32_t Length = GetU32(At);
+    uint32_t Index = GetU32(At);
+    if(Length > (uint32_t)Capacity || Index >= (uint32_t)Capacity) return 0;
+    if(Length < (uint32_t)Capacity && Index != Length) return 0;
+    *Ring = (ring){.Length = (int)Length, .Capacity = Capacity, .Index = (int)Index};
+    return 1;
+}
+
+// Leaves World alone and returns 0 when the data is not a whole,
+// well formed snapshot
+
+int DeserializeWorld(world *World, uint8_t *Data, size_t Size) {
+
+    // The rest is checked once the ring lengths are known
+    if(Size < GetSnapshotSize(0, 0)) return 0;
+
+    uint8_t *At = Data;
+    if(memcmp(At, "FBSN", 4)) return 0;
+    At += 4;
+    if(GetU32(&At) != SNAPSHOT_VERSION) return 0;
+
+    world Result = {0};
+
+    Result.Seed = GetU32(&At);
+    for(int Index = 0; Index < 4; ++Index) {
+        Result.Random.State[Index] = GetU32(&At);
+    }
+    Result.Tick = (int)GetU32(&At);
+    Result.PipeTicks = (int)GetU32(&At);
+    Result.TrailTicks = (int)GetU32(&At);
+    Result.Score = (int)GetU32(&At);
+    Result.PracticeMode = GetU8(&At);
+    Result.Pause = GetU8(&At);
+    Result.Running = GetU8(&At);
+
+    bird *Bird = &Result.Bird;
+    Bird->Position = GetV3(&At);
+    Bird->PreviousPosition = GetV3(&At);
+    Bird->Velocity = GetV3(&At);
+    Bird->MaxVelocity = GetFloat(&At);
+
+    pipeStore *Pipes = &Result.Pipes;
+    if(!GetRing(&At, &Pipes->Ring, MAX_PIPES_AMOUNT)) return 0;
+    // Pipes come in pairs, bottom pipes at even slots
+    if((Pipes->Ring.Length | Pipes->Ring.Index) & 1) return 0;
+    if(Size < GetSnapshotSize(Pipes->Ring.Length, 0)) return 0;
+    for(int Slot = 0; Slot < Pipes->Ring.Length; ++Slot) {
+        Pipes->X[Slot] = GetFloat(&At);
+        Pipes->Y[Slot] = GetFloat(&At);
+        Pipes->PreviousX[Slot] = GetFloat(&At);
+        Pipes->Hit[Slot] = GetU8(&At);
+    }
+
+    trailStore *Trail = &Result.Trail;
+    if(!GetRing(&At, &Trail->Ring, MAX_TRAIL_LENGTH)) return 0;
+    if(Size != GetSnapshotSize(Pipes->Ring.Length, Trail->Ring.Length)) return 0;
+    for(int Slot = 0; Slot < Trail->Ring.Length; ++Slot) {
+        Trail->SpawnTick[Slot] = (int)GetU32(&At);
+        Trail->X[Slot] = GetFloat(&At);
+        Trail->Y[Slot] = GetFloat(&At);
+    }
+
+    *World = Result;
+    return 1;
+}
+
+int WriteSnapshot(world *World, char *Path) {
+    uint8_t Data[MAX_SNAPSHOT_SIZE];
+    size_t Size = SerializeWorld(World, Data, sizeof(Data));
+    if(!Size) return 0;
+
+    FILE *File = fopen(Path, "wb");
+    if(!File) return 0;
+    int Written = fwrite(Data, 1, Size, File) == Size;
+    return (fclose(File) == 0) && Written;
+}
+
+int ReadSnapshot(world *World, char *Path) {
+    FILE *File = fopen(Path, "rb");
+    if(!File) return 0;
+
+    // One byte more than fits, so an overlong file fails to parse
+    uint8_t Data[MAX_SNAPSHOT_SIZE + 1];
+    size_t Size = fread(Data, 1, sizeof(Data), File);
+    fclose(File);
+
+    return DeserializeWorld(World, Data, Size);
+}
+
+#endif
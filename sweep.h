@@ -0,0 +1,231 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+// Coarse stepping for fast-forward and search tools. StepWorldCoarse()
+// runs many fixed steps of one input in a single call, where Ticks
+// calls to UpdateWorld() would run them one by one.
+//
+// Moving everything by Ticks steps and testing for overlap once would
+// tunnel. At 1/10 s a pipe moves 2 of the 5 units it overlaps the bird
+// along X, and at 1/2 s it jumps the bird completely. Instead the
+// collision is swept:
+//
+// - the bird's heights at every step come first. They cost a few
+//   multiply-adds each and use the same float operations as
+//   UpdateWorld().
+// - pipes move along X in a straight line, so a 1D sweep gives the
+//   steps at which a pipe overlaps the bird along X
+// - only those steps get the Y test
+//
+// The first step with an overlap is the time of impact. It is the same
+// step the fine stepping reports. The game samples collisions once per
+// step, so a sweep in continuous time would flag grazes between two
+// steps that the game never sees.
+//
+// The world comes out bit for bit the same as with fine stepping. The
+// bird's heights and the pipes' positions go through the same float
+// operations, pipes included: they move by one step's distance at a
+// time, never by the run's distance at once, which would round
+// differently and add up over a game.
+//
+// Previous positions are the ones at the start of the coarse step, so
+// the renderer blends across all of it.
+
+#include "game.h"
+
+// Longest run without a spawn that is swept in one go
+#define MAX_SWEEP_STEPS 64
+
+int FloorToInt(double Value) {
+    int Result = (int)Value;
+    return Result - (Value < Result);
+}
+
+int CeilToInt(double Value) {
+    int Result = (int)Value;
+    return Result + (Value > Result);
+}
+
+// Steps, counted from 1, at which a pipe at X checked now and then every
+// step PipeStep further left overlaps [Left, Right] along X. Empty when
+// First > Last.
+
+void SweepPipeX(float X, float HalfWidth, float PipeStep, float Left, float Right, int *First, int *Last) {
+    // X - (Step - 1) * PipeStep - HalfWidth <= Right and
+    // X - (Step - 1) * PipeStep + HalfWidth >= Left
+    *First = CeilToInt(((double)X - HalfWidth - Right) / PipeStep) + 1;
+    *Last = FloorToInt(((double)X + HalfWidth - Left) / PipeStep) + 1;
+}
+
+// Runs up to Steps steps that spawn no pipes. Returns the steps run,
+// fewer when a hit outside practice mode ends the game. That step is
+// still run to its end, like UpdateWorld() does.
+
+int SweepSteps(world *World, float Acceleration, int Steps) {
+
+    bird *Bird = &World->Bird;
+    pipeStore *Pipes = &World->Pipes;
+    trailStore *Trail = &World->Trail;
+
+    // Bird heights at the end of every step, with the same float
+    // operations as UpdateWorld()
+
+    float Heights[MAX_SWEEP_STEPS + 1];
+    float Scale = DeltaTime * BirdSpeed;
+    float Change = Acceleration * Scale;
+    float Y = Bird->Position.Y;
+    float Velocity = Bird->Velocity.Y;
+
+    Heights[0] = Y;
+    for(int Step = 1; Step <= Steps; ++Step) {
+        Velocity += Change;
+        if(Velocity >= Bird->MaxVelocity) {
+            Velocity = Bird->MaxVelocity;
+        }
+        Y += Velocity * Scale;
+        Heights[Step] = Y;
+    }
+
+    // Collision. Pipes the bird does not reach during the run, or has
+    // passed already, are out after two compares.
+
+    float PipeStep = DeltaTime * PipeSpeed;
+    float BirdX = Bird->Position.X;
+    float BirdLeft = BirdX - BirdWidth / 2.0f;
+    float BirdRight = BirdX + BirdWidth / 2.0f;
+    float Travel = (float)Steps * PipeStep; // a step of slack
+
+    int Impact = Steps + 1;
+    uint32_t Hits = 0;
+
+    for(int Index = 0; Index < Pipes->Ring.Length; ++Index) {
+        float X = Pipes->X[Index];
+        if(X - PipeWidth / 2.0f - Travel > BirdRight || X + PipeWidth / 2.0f < BirdLeft) continue;
+
+        int First, Last;
+        SweepPipeX(X, PipeWidth / 2.0f, PipeStep, BirdLeft, BirdRight, &First, &Last);
+
+        // One step of slack on each side, the exact test below settles
+        // what rounding leaves open
+        if(--First < 1) First = 1;
+        if(++Last > Impact - 1) Last = Impact - 1;
+
+        // Where the pipe is tested at First, stepped there the way
+        // UpdateWorld() moves it
+
+        float PipeX = X;
+        for(int Step = 1; Step < First; ++Step) {
+            PipeX -= PipeStep;
+        }
+
+        float PipeY = Pipes->Y[Index];
+        for(int Step = First; Step <= Last; ++Step, PipeX -= PipeStep) {
+            if(BirdLeft > PipeX + PipeWidth / 2.0f || PipeX - PipeWidth / 2.0f > BirdRight) continue;
+            if(Heights[Step] - BirdHeight / 2.0f > PipeY + PipeHeight / 2.0f ||
+               PipeY - PipeHeight / 2.0f > Heights[Step] + BirdHeight / 2.0f) continue;
+
+            Hits |= 1u << Index;
+            if(!World->PracticeMode && Step < Impact) Impact = Step;
+            break;
+        }
+    }
+
+    int Run = Impact <= Steps ? Impact : Steps;
+
+    if(Hits) {
+        if(World->PracticeMode) {
+            for(int Index = 0; Index < Pipes->Ring.Length; ++Index) {
+                Pipes->Hit[Index] |= (Hits >> Index) & 1;
+            }
+        } else {
+            World->Running = 0;
+        }
+    }
+
+    // Trail pieces added during the run, each with the bird's height at
+    // its step
+
+    for(int Step = 1; Step <= Run; ++Step) {
+        if(++World->TrailTicks < TrailSpawnTicks) continue;
+        World->TrailTicks = 0;
+        AddTrail(Trail, World->Tick + Step, BirdX, Heights[Step]);
+    }
+
+    // Pipes, a point for every bottom pipe that passed the bird. They
+    // only move left, so one that passed during the run was at or right
+    // of the bird before and is left of it now.
+
+    float Old[MAX_PIPES_AMOUNT];
+    memcpy(Old, Pipes->X, Pipes->Ring.Length * sizeof(float));
+
+    for(int Step = 1; Step <= Run; ++Step) {
+        Kernels.AdvanceX(Pipes->X, Pipes->Ring.Length, PipeStep);
+    }
+
+    for(int Index = 0; Index < Pipes->Ring.Length; Index += 2) {
+        if(Old[Index] >= BirdX && Pipes->X[Index] < BirdX) {
+            ++World->Score;
+        }
+    }
+
+    // Replay the bird up to the impact if the run was cut short
+
+    if(Run < Steps) {
+        Velocity = Bird->Velocity.Y;
+        for(int Step = 1; Step <= Run; ++Step) {
+            Velocity += Change;
+            if(Velocity >= Bird->MaxVelocity) {
+                Velocity = Bird->MaxVelocity;
+            }
+        }
+    }
+    Bird->Position.Y = Heights[Run];
+    Bird->Velocity.Y = Velocity;
+
+    World->Tick += Run;
+    return Run;
+}
+
+// Same as Ticks calls to UpdateWorld() with Input, except that the
+// toggles apply once. Returns the steps run, fewer when a hit outside
+// practice mode ends the game.
+
+int StepWorldCoarse(world *World, input *Input, int Ticks) {
+
+    if(Input->TogglePause) {
+        World->Pause = !World->Pause;
+    }
+    if(Input->TogglePracticeMode) {
+        World->PracticeMode = !World->PracticeMode;
+    }
+
+    if(World->Pause) return Ticks;
+
+    SavePreviousPositions(World);
+
+    float Acceleration = Input->Flap ? 4 * Gravity : -Gravity;
+
+    // Pipes spawn at the end of a step, split the run there
+    int Done = 0;
+    while(Done < Ticks) {
+        int ToSpawn = PipeSpawnTicks - World->PipeTicks;
+        if(ToSpawn < 1) ToSpawn = 1;
+        int Steps = Ticks - Done < ToSpawn ? Ticks - Done : ToSpawn;
+        if(Steps > MAX_SWEEP_STEPS) Steps = MAX_SWEEP_STEPS;
+
+        int Run = SweepSteps(World, Acceleration, Steps);
+        Done += Run;
+
+        World->PipeTicks += Run;
+        if(World->PipeTicks >= PipeSpawnTicks) {
+            SpawnPipePair(World);
+            World->PipeTicks = 0;
+        }
+
+        if(Run < Steps) break;
+    }
+
+    return Done;
+}
+
+#endif